@@ -1,9 +1,46 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
 #include <stdint.h>
-#include <math.h>
+#include <limits.h>
+#include <stddef.h>
 #include <time.h>
+#include <pthread.h>   /* -j N; em glibc < 2.34 compilar com -pthread */
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+#include <sys/uio.h>
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define TEM_X86_SIMD 1
+#endif
+
+/* Sondas do relatório do --stats: compiladas por padrão, -DINSTRUMENTAR=0 as remove. */
+#ifndef INSTRUMENTAR
+#define INSTRUMENTAR 1
+#endif
+
+/* Alocações do próprio programa, contadas para --stats e --bench-corpus (malloc/calloc/realloc
+ * só por aqui; o alocador do processo não é trocado). */
+static unsigned long ALOCACOES;
+
+static inline void *alocar(size_t n) {
+    __atomic_fetch_add(&ALOCACOES, 1, __ATOMIC_RELAXED);
+    return malloc(n);
+}
+
+static inline void *alocar_zerado(size_t n, size_t m) {
+    __atomic_fetch_add(&ALOCACOES, 1, __ATOMIC_RELAXED);
+    return calloc(n, m);
+}
+
+static inline void *realocar(void *p, size_t n) {
+    __atomic_fetch_add(&ALOCACOES, 1, __ATOMIC_RELAXED);
+    return realloc(p, n);
+}
 
 #define BUF_IN_SZ (1 << 20)
 #define HEX2BUF(c1, c2) ((hex_byte[(unsigned char)(c1)] << 4) | hex_byte[(unsigned char)(c2)])
@@ -20,15 +57,84 @@ static void init_hex_table(void) {
     for (int i = 'a'; i <= 'f'; i++) hex_byte[i] = i - 'a' + 10;
 }
 
+/* Tabela de códigos Huffman: bits e comprimento por símbolo (len 0 = não usado). */
+typedef struct tabela_huf {
+    uint64_t cod[256];
+    uint8_t len[256];
+} tabela_huf;
+
+/* Índices em CODECS[] */
+enum { CODEC_HUF, CODEC_RLE, CODEC_LZ77, CODEC_RC, CODEC_RLEA, NUM_CODECS };
+
 typedef struct sequencia {
     int tamanho;
-    char** conteudo;
-    float percentual_HUFF;
-    float percentual_RLE;
-    char* conteudo_comprimido_RLE;
-    char* conteudo_comprimido_HUFF;
+    uint8_t* conteudo;                /* tokens já convertidos para bytes */
+    float percentual[NUM_CODECS];
+    char* comprimido[NUM_CODECS];     /* payload em hex por codec; NULL = não gerado */
+    tabela_huf tab;                   /* códigos Huffman (linha CAN e --verify) */
+    uint64_t bits_huf;
+    int codec_bin;                    /* -b: codec do registro (o primeiro vencedor) */
+    uint8_t *bruto;                   /* -b: payload binário desse codec */
+    size_t n_bruto;
 } sequencia;
 
+/* Opções de linha de comando (somente leitura depois de main() as preencher). */
+typedef struct opcoes {
+    int canonico;             /* -c: Huffman canônico (sem árvore) */
+    int emitir_comprimentos;  /* -L: emite a linha CAN com os comprimentos (implica -c) */
+    int descomprimir;         /* -d: lê a saída da ferramenta e reconstrói a entrada */
+    int verificar;            /* --verify: decodifica em memória e compara com a entrada */
+    int estimar;              /* -e: calcula os tamanhos antes e só materializa o vencedor */
+    unsigned codecs;          /* -C lista: máscara de codecs ativos (padrão HUF e RLE) */
+    int threads;              /* -j N: workers de compressão (<= 1: serial) */
+    int janela;               /* -w W: máximo de sequências em voo no modo -j */
+    int estatisticas;         /* --stats: imprime contadores ao final */
+    int arvore_duas_filas;    /* -Q: árvore por duas filas (payload HUF pode diferir do gabarito) */
+    int binario;              /* -b: contêiner binário em vez do texto (implica -c) */
+    const char *extrair;      /* --extract N[,M..]: só essas sequências de um contêiner -b */
+    int limite;               /* -l N: comprimento máximo dos códigos Huffman (implica -c; 0 = sem) */
+    int threads_seq;          /* -p N: threads por sequência grande no HUF (<= 1: serial) */
+} opcoes;
+
+static opcoes OPC;
+
+/* ---------- --stats: contadores do pipeline ----------
+ * Cada thread acumula no seu ST, sem atomics no caminho quente, e soma em ST_TOTAL ao
+ * terminar. Sem --stats cada sonda custa um teste; com -DINSTRUMENTAR=0 não existe. */
+enum { ST_PARSE, ST_HISTOGRAMA, ST_ARVORE, ST_ESCRITA, ST_VERIFICACAO, NUM_FASES_ST };
+
+typedef struct contadores {
+    uint64_t ns_fase[NUM_FASES_ST];
+    uint64_t ns_codec[NUM_CODECS];                   /* preparar + estimar/codificar (com hex) */
+    uint64_t entrada[NUM_CODECS], saida[NUM_CODECS]; /* bytes; saída = tamanho do payload binário */
+    uint64_t vitorias[NUM_CODECS], empates;
+    uint64_t sequencias, bytes;
+    uint64_t medidas;                                /* sequências com entropia (t > 0) */
+    double entropia;                                 /* soma de H * t, em bits */
+    double entropia_min, entropia_max;               /* bits/byte */
+    uint64_t faixa_entropia[8];                      /* sequências por faixa de 1 bit/byte */
+} contadores;
+
+#if INSTRUMENTAR
+static __thread contadores ST;
+static contadores ST_TOTAL;
+static pthread_mutex_t ST_MTX = PTHREAD_MUTEX_INITIALIZER;
+
+static inline uint64_t st_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+#define SONDA_INICIO(v) uint64_t v = OPC.estatisticas ? st_ns() : 0
+#define SONDA_FIM(campo, v) do { if (OPC.estatisticas) ST.campo += st_ns() - (v); } while (0)
+#define SONDA(instr) do { if (OPC.estatisticas) { instr; } } while (0)
+#else
+#define SONDA_INICIO(v) do { } while (0)
+#define SONDA_FIM(campo, v) do { } while (0)
+#define SONDA(instr) do { } while (0)
+#endif
+
 typedef struct node {
     int freq;
     char S;
@@ -36,6 +142,42 @@ typedef struct node {
     struct node *E;
 } no;
 
+/* Arena de bump por thread para a árvore e as filas: no máximo 511 nós e os vetores de
+ * ponteiros (513 no heap, 3 x 256 nas duas filas) por sequência. construir_arvore() a reinicia a cada sequência, sem free;
+ * um malloc só acontece quando a arena ainda não existe ou não comporta o pedido. */
+typedef struct arena {
+    uint8_t *base;
+    size_t usado, cap;
+} arena;
+
+#define ARENA_CAP (64u << 10)
+
+static __thread arena ARENA_HUF;
+static unsigned long ALOCACOES_ARENA;   /* mallocs feitos pelas arenas (--stats) */
+
+static void *arena_alocar(arena *a, size_t n) {
+    n = (n + 15) & ~(size_t)15;
+    if (a->usado + n > a->cap) {
+        /* Só na primeira vez (ou pedido maior que a arena): o conteúdo anterior já foi descartado. */
+        size_t cap = n > ARENA_CAP ? n : ARENA_CAP;
+        free(a->base);
+        a->base = (uint8_t*)alocar(cap);
+        a->cap = cap;
+        a->usado = 0;
+        __atomic_fetch_add(&ALOCACOES_ARENA, 1, __ATOMIC_RELAXED);
+    }
+    void *p = a->base + a->usado;
+    a->usado += n;
+    return p;
+}
+
+static void arena_reiniciar(arena *a) { a->usado = 0; }
+
+static void arena_destruir(arena *a) {
+    free(a->base);
+    memset(a, 0, sizeof(*a));
+}
+
 typedef struct fila_p_min {
     int tam;
     int cap;
@@ -43,13 +185,31 @@ typedef struct fila_p_min {
 } fila_p_min;
 
 fila_p_min *criar_fila_p_min() {
-    fila_p_min *fpm = (fila_p_min*)malloc(sizeof(fila_p_min));
+    fila_p_min *fpm = (fila_p_min*)arena_alocar(&ARENA_HUF, sizeof(fila_p_min));
     fpm->tam = 0;
     fpm->cap = 512;
-    fpm->V = (no**)malloc((fpm->cap + 1) * sizeof(no*));
+    fpm->V = (no**)arena_alocar(&ARENA_HUF, (fpm->cap + 1) * sizeof(no*));
     return fpm;
 }
 
+/* Garante espaço para mais um elemento (com 256 símbolos a capacidade inicial basta). */
+static void fila_garantir(fila_p_min *fpm) {
+    if (fpm->tam + 1 < fpm->cap) return;
+    no **V = (no**)arena_alocar(&ARENA_HUF, (2 * fpm->cap + 1) * sizeof(no*));
+    memcpy(V, fpm->V, (fpm->cap + 1) * sizeof(no*));
+    fpm->V = V;
+    fpm->cap *= 2;
+}
+
+static no *novo_no(int freq, char S, no *E, no *D) {
+    no *novo = (no*)arena_alocar(&ARENA_HUF, sizeof(no));
+    novo->freq = freq;
+    novo->S = S;
+    novo->E = E;
+    novo->D = D;
+    return novo;
+}
+
 /* Heapify (descer): garante que a subárvore em i satisfaz a propriedade de heap mínimo. O(N) no build-heap. */
 static void heapify(fila_p_min *fpm, int i) {
     while (2 * i <= fpm->tam) {
@@ -71,16 +231,9 @@ static void build_heap(fila_p_min *fpm) {
 }
 
 void inserir(fila_p_min *fpm, int freq, char S, no *E, no *D) {
-    if (fpm->tam + 1 >= fpm->cap) {
-        fpm->cap *= 2;
-        fpm->V = (no**)realloc(fpm->V, (fpm->cap + 1) * sizeof(no*));
-    }
+    fila_garantir(fpm);
     fpm->tam++;
-    no* novo = (no*)malloc(sizeof(no));
-    novo->freq = freq;
-    novo->S = S;
-    novo->E = E;
-    novo->D = D;
+    no* novo = novo_no(freq, S, E, D);
     int i = fpm->tam;
     fpm->V[i] = novo;
     while (i > 1 && fpm->V[i]->freq < fpm->V[i / 2]->freq) {
@@ -99,28 +252,19 @@ no *extrair_min(fila_p_min *fpm) {
     return min;
 }
 
-no *construir_arvore(int H[], int n) {
+/* Construtor padrão (e do -H): heap binário, build_heap e 2 extrair_min + inserir por fusão.
+ * A árvore vive na arena da thread e vale até a próxima chamada (não há liberar). */
+no *construir_arvore_heap(int H[], int n) {
+    arena_reiniciar(&ARENA_HUF);
     fila_p_min *fpm = criar_fila_p_min();
     /* Inserir todos os nós no vetor de uma vez (símbolos com frequência > 0). */
     for (int i = 0; i < n; i++) {
         if (H[i] > 0) {
-            if (fpm->tam + 1 >= fpm->cap) {
-                fpm->cap *= 2;
-                fpm->V = (no**)realloc(fpm->V, (fpm->cap + 1) * sizeof(no*));
-            }
-            no *novo = (no*)malloc(sizeof(no));
-            novo->freq = H[i];
-            novo->S = (char)i;
-            novo->E = NULL;
-            novo->D = NULL;
-            fpm->V[++fpm->tam] = novo;
+            fila_garantir(fpm);
+            fpm->V[++fpm->tam] = novo_no(H[i], (char)i, NULL, NULL);
         }
     }
-    if (fpm->tam == 0) {
-        free(fpm->V);
-        free(fpm);
-        return NULL;
-    }
+    if (fpm->tam == 0) return NULL;
     /* Construção do heap em tempo linear (heapify reverso / build-heap). */
     build_heap(fpm);
     while (fpm->tam > 1) {
@@ -128,18 +272,65 @@ no *construir_arvore(int H[], int n) {
         no *y = extrair_min(fpm);
         inserir(fpm, x->freq + y->freq, '\0', x, y);
     }
-    no *raiz = extrair_min(fpm);
-    free(fpm->V);
-    free(fpm);
-    return raiz;
+    return extrair_min(fpm);
+}
+
+/* Ordena os ponteiros por freq com radix LSD de 8 bits (estável: empates ficam em ordem
+ * de símbolo). Dígitos iguais em todas as folhas (em geral os altos) são pulados. */
+static void ordenar_folhas(no **v, no **aux, int n) {
+    for (int desl = 0; desl < 32; desl += 8) {
+        int cont[257] = { 0 };
+        for (int i = 0; i < n; i++) cont[(((unsigned)v[i]->freq >> desl) & 0xFF) + 1]++;
+        if (cont[(((unsigned)v[0]->freq >> desl) & 0xFF) + 1] == n) continue;
+        for (int d = 0; d < 256; d++) cont[d + 1] += cont[d];
+        for (int i = 0; i < n; i++) aux[cont[((unsigned)v[i]->freq >> desl) & 0xFF]++] = v[i];
+        memcpy(v, aux, (size_t)n * sizeof(no*));
+    }
+}
+
+/* Menor frente entre folhas[f..nf) e internos[ini..fim). No empate sai a folha. */
+static inline no *menor_frente(no **folhas, int *f, int nf, no **internos, int *ini, int fim) {
+    if (*f < nf && (*ini == fim || folhas[*f]->freq <= internos[*ini]->freq)) return folhas[(*f)++];
+    return internos[(*ini)++];
+}
+
+/* Construtor do -Q, O(n) depois da ordenação: duas filas (folhas ordenadas e nós internos
+ * na ordem de criação, que já sai crescente). A árvore tem o mesmo custo total da do heap,
+ * então os percentuais não mudam, mas os empates seguem outra regra (folha antes de nó
+ * interno, folhas por símbolo) e os bits do payload HUF podem diferir do gabarito. */
+no *construir_arvore_duas_filas(int H[], int n) {
+    arena_reiniciar(&ARENA_HUF);
+    no **folhas = (no**)arena_alocar(&ARENA_HUF, 3 * (size_t)n * sizeof(no*));
+    no **aux = folhas + n, **internos = folhas + 2 * n;
+    int nf = 0;
+    for (int i = 0; i < n; i++)
+        if (H[i] > 0) folhas[nf++] = novo_no(H[i], (char)i, NULL, NULL);
+    if (nf == 0) return NULL;
+    if (nf == 1) return folhas[0];
+    ordenar_folhas(folhas, aux, nf);
+
+    int f = 0, ini = 0, fim = 0;
+    for (int fusoes = nf - 1; fusoes > 0; fusoes--) {
+        no *x = menor_frente(folhas, &f, nf, internos, &ini, fim);
+        no *y = menor_frente(folhas, &f, nf, internos, &ini, fim);
+        internos[fim++] = novo_no(x->freq + y->freq, '\0', x, y);
+    }
+    return internos[fim - 1];
 }
 
-void tabela_codigos_iter(no *raiz, char *T[], int *T_len) {
+/* O heap é o padrão: o gabarito espera os códigos da árvore dele. */
+no *construir_arvore(int H[], int n) {
+    return OPC.arvore_duas_filas ? construir_arvore_duas_filas(H, n) : construir_arvore_heap(H, n);
+}
+
+/* Percorre a árvore gerando, para cada símbolo, o código como par (bits, comprimento).
+ * Profundidade máxima ~45 (frequências int), por isso os bits cabem em 64 bits. */
+void tabela_codigos_iter(no *raiz, uint64_t cod[256], uint8_t len[256]) {
     if (raiz == NULL) return;
 
     typedef struct {
         no *node;
-        char path[256];
+        uint64_t bits;
         int depth;
     } StackNode;
 
@@ -147,8 +338,8 @@ void tabela_codigos_iter(no *raiz, char *T[], int *T_len) {
     int top = 0;
 
     stack[0].node = raiz;
+    stack[0].bits = 0;
     stack[0].depth = 0;
-    stack[0].path[0] = '\0';
     top++;
 
     while (top > 0) {
@@ -158,163 +349,608 @@ void tabela_codigos_iter(no *raiz, char *T[], int *T_len) {
         if (node->E == NULL && node->D == NULL) {
             int idx = (unsigned char)node->S;
             if (current.depth == 0) {
-                T[idx][0] = '0';
-                T[idx][1] = '\0';
-                T_len[idx] = 1;
+                cod[idx] = 0;
+                len[idx] = 1;
             } else {
-                memcpy(T[idx], current.path, current.depth);
-                T[idx][current.depth] = '\0';
-                T_len[idx] = current.depth;
+                cod[idx] = current.bits;
+                len[idx] = (uint8_t)current.depth;
             }
         } else {
             if (node->D) {
-                StackNode next;
-                next.node = node->D;
-                next.depth = current.depth + 1;
-                memcpy(next.path, current.path, current.depth);
-                next.path[current.depth] = '1';
-                stack[top++] = next;
+                stack[top].node = node->D;
+                stack[top].bits = (current.bits << 1) | 1;
+                stack[top].depth = current.depth + 1;
+                top++;
             }
             if (node->E) {
-                StackNode next;
-                next.node = node->E;
-                next.depth = current.depth + 1;
-                memcpy(next.path, current.path, current.depth);
-                next.path[current.depth] = '0';
-                stack[top++] = next;
+                stack[top].node = node->E;
+                stack[top].bits = current.bits << 1;
+                stack[top].depth = current.depth + 1;
+                top++;
             }
         }
     }
 }
 
-void liberar_arvore(no *raiz) {
-    if (raiz == NULL) return;
-    liberar_arvore(raiz->E);
-    liberar_arvore(raiz->D);
-    free(raiz);
+/* Comprimentos de código in-place (Moffat–Katajainen). A[] chega com os pesos em
+ * ordem crescente e sai com o comprimento de cada posição; n >= 2. */
+static void comprimentos_in_place(uint32_t A[], int n) {
+    int raiz = 0, folha = 2, prox;
+    A[0] += A[1];
+    for (prox = 1; prox < n - 1; prox++) {
+        if (folha >= n || A[raiz] < A[folha]) { A[prox] = A[raiz]; A[raiz++] = (uint32_t)prox; }
+        else A[prox] = A[folha++];
+        if (folha >= n || (raiz < prox && A[raiz] < A[folha])) { A[prox] += A[raiz]; A[raiz++] = (uint32_t)prox; }
+        else A[prox] += A[folha++];
+    }
+
+    A[n - 2] = 0;
+    for (prox = n - 3; prox >= 0; prox--) A[prox] = A[A[prox]] + 1;
+
+    int disp = 1, usados = 0, prof = 0;
+    raiz = n - 2;
+    prox = n - 1;
+    while (disp > 0) {
+        while (raiz >= 0 && A[raiz] == (uint32_t)prof) { usados++; raiz--; }
+        while (disp > usados) { A[prox--] = (uint32_t)prof; disp--; }
+        disp = 2 * usados;
+        prof++;
+        usados = 0;
+    }
+}
+
+/* Comprimentos ótimos limitados a L bits (package-merge); w[] crescente, 2 <= n <= 2^L.
+ * A lista do nível L só tem as folhas; a do nível k < L intercala as folhas com os pacotes
+ * (pares consecutivos) da lista k + 1. Tomam-se os 2n - 2 primeiros itens do nível 1, e cada
+ * pacote tomado puxa os 2 itens do nível de baixo. As folhas tomadas num nível são sempre um
+ * prefixo, então basta marcar quem é folha; o comprimento da folha i é o nº de níveis em que
+ * ela foi tomada. */
+static void comprimentos_limitados(const uint32_t w[], int n, int L, uint8_t comp[]) {
+    uint64_t peso[2][512];
+    uint8_t folha[64][512];
+    int tam = n, cur = 0;
+    for (int j = 0; j < n; j++) { peso[0][j] = w[j]; folha[L - 1][j] = 1; }
+    for (int k = L - 2; k >= 0; k--) {
+        const uint64_t *ant = peso[cur];
+        uint64_t *novo = peso[cur ^ 1];
+        int pacotes = tam / 2, a = 0, b = 0, m = 0;
+        while (a < n || b < pacotes) {
+            uint64_t pp = b < pacotes ? ant[2 * b] + ant[2 * b + 1] : UINT64_MAX;
+            if (a < n && w[a] <= pp) { novo[m] = w[a++]; folha[k][m++] = 1; }
+            else { novo[m] = pp; b++; folha[k][m++] = 0; }
+        }
+        tam = m;
+        cur ^= 1;
+    }
+    memset(comp, 0, (size_t)n);
+    for (int k = 0, tomar = 2 * n - 2; k < L && tomar > 0; k++) {
+        int folhas = 0;
+        for (int j = 0; j < tomar; j++) folhas += folha[k][j];
+        for (int i = 0; i < folhas; i++) comp[i]++;
+        tomar = 2 * (tomar - folhas);
+    }
 }
 
+static int cmp_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+    return (x > y) - (x < y);
+}
 
-char* HUF(char **strings, int t) {
-    init_hex_table();
-    uint8_t *bytes = (uint8_t*)malloc((size_t)t * sizeof(uint8_t));
-    for (int i = 0; i < t; i++)
-        bytes[i] = HEX2BUF(strings[i][0], strings[i][1]);
+/* Atribui códigos canônicos (ordem: comprimento, depois símbolo) a partir de len[]. */
+static void codigos_canonicos(const uint8_t len[256], uint64_t cod[256]) {
+    int qtd[65] = {0};
+    uint64_t prox[65];
+    for (int s = 0; s < 256; s++) qtd[len[s]]++;
+    qtd[0] = 0;
+    uint64_t c = 0;
+    for (int l = 1; l <= 64; l++) {
+        c = (c + (uint64_t)qtd[l - 1]) << 1;
+        prox[l] = c;
+    }
+    for (int s = 0; s < 256; s++)
+        if (len[s]) cod[s] = prox[len[s]]++;
+}
+
+/* Huffman canônico: só comprimentos, sem árvore nem malloc. Devolve o nº de símbolos usados.
+ * limite > 0 (-l): nenhum código passa de limite bits (sobe para ceil(log2 n) se não couber);
+ * o package-merge só roda quando o Huffman sem limite passa dele. */
+int huffman_canonico(const int H[256], uint64_t cod[256], uint8_t len[256], int limite) {
+    uint64_t chaves[256];
+    uint32_t A[256];
+    int n = 0;
+    for (int s = 0; s < 256; s++)
+        if (H[s] > 0) chaves[n++] = ((uint64_t)H[s] << 8) | (uint64_t)s;
+    memset(len, 0, 256);
+    if (n == 0) return 0;
+    if (n == 1) {
+        len[chaves[0] & 0xFF] = 1;
+        cod[chaves[0] & 0xFF] = 0;
+        return 1;
+    }
+    qsort(chaves, (size_t)n, sizeof(uint64_t), cmp_u64);
+    for (int i = 0; i < n; i++) A[i] = (uint32_t)(chaves[i] >> 8);
+    comprimentos_in_place(A, n);
+    if (limite > 0 && A[0] > (uint32_t)limite) {
+        uint8_t comp[256];
+        while (n > (1 << (limite < 9 ? limite : 9))) limite++;
+        for (int i = 0; i < n; i++) A[i] = (uint32_t)(chaves[i] >> 8);
+        comprimentos_limitados(A, n, limite, comp);
+        for (int i = 0; i < n; i++) A[i] = comp[i];
+    }
+    for (int i = 0; i < n; i++) len[chaves[i] & 0xFF] = (uint8_t)A[i];
+    codigos_canonicos(len, cod);
+    return n;
+}
+
+const char hex_table[] = "0123456789ABCDEF";
 
-    int histograma[256] = {0};
-    for (int i = 0; i < t; i++) histograma[bytes[i]]++;
+/* Escritor de bits: acumulador de 64 bits descarregado byte a byte (MSB primeiro). */
+typedef struct escritor_bits {
+    uint8_t *buf;
+    size_t pos;
+    uint64_t acc;
+    int n;
+} escritor_bits;
 
-    no *arvore = construir_arvore(histograma, 256);
-    if (!arvore) {
-        free(bytes);
-        return NULL;
+static inline void eb_escrever(escritor_bits *eb, uint64_t bits, int len) {
+    if (len > 32) {
+        eb_escrever(eb, bits >> 32, len - 32);
+        bits &= 0xFFFFFFFFu;
+        len = 32;
     }
+    eb->acc = (eb->acc << len) | bits;
+    eb->n += len;
+    while (eb->n >= 8) {
+        eb->n -= 8;
+        eb->buf[eb->pos++] = (uint8_t)(eb->acc >> eb->n);
+    }
+}
 
-    char *codigos = (char*)calloc(256 * 256, sizeof(char));
-    int T_len[256];
-    memset(T_len, 0, sizeof(T_len));
-    char *T[256];
-    for (int i = 0; i < 256; i++) T[i] = &codigos[i * 256];
+/* Completa o último byte com zeros à direita. */
+static inline void eb_finalizar(escritor_bits *eb) {
+    if (eb->n > 0) {
+        eb->buf[eb->pos++] = (uint8_t)(eb->acc << (8 - eb->n));
+        eb->n = 0;
+    }
+}
 
-    tabela_codigos_iter(arvore, T, T_len);
+/* Formatação byte -> 2 caracteres hex (maiúsculos), sem terminador. */
+static void formatar_hex_escalar(const uint8_t *bytes, size_t n, char *hex) {
+    for (size_t i = 0; i < n; i++) {
+        hex[2 * i] = hex_table[bytes[i] >> 4];
+        hex[2 * i + 1] = hex_table[bytes[i] & 0xF];
+    }
+}
 
-    size_t total_len = 0;
-    for (int i = 0; i < t; i++) total_len += (size_t)T_len[bytes[i]];
+#ifdef TEM_X86_SIMD
+/* 16 bytes por iteração: nibbles via pshufb na tabela "0123456789ABCDEF" e intercalação alto/baixo. */
+__attribute__((target("ssse3")))
+static void formatar_hex_ssse3(const uint8_t *bytes, size_t n, char *hex) {
+    const __m128i tab = _mm_loadu_si128((const __m128i*)hex_table);
+    const __m128i m4 = _mm_set1_epi8(0x0F);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(bytes + i));
+        __m128i hi = _mm_shuffle_epi8(tab, _mm_and_si128(_mm_srli_epi16(v, 4), m4));
+        __m128i lo = _mm_shuffle_epi8(tab, _mm_and_si128(v, m4));
+        _mm_storeu_si128((__m128i*)(hex + 2 * i), _mm_unpacklo_epi8(hi, lo));
+        _mm_storeu_si128((__m128i*)(hex + 2 * i + 16), _mm_unpackhi_epi8(hi, lo));
+    }
+    formatar_hex_escalar(bytes + i, n - i, hex + 2 * i);
+}
 
-    char *saida = (char*)malloc(total_len + 1);
-    char *ptr = saida;
-    for (int i = 0; i < t; i++) {
-        int len = T_len[bytes[i]];
-        memcpy(ptr, T[bytes[i]], (size_t)len);
-        ptr += len;
+/* 32 bytes por iteração; o permute prévio desfaz o unpack por lane do AVX2. */
+__attribute__((target("avx2")))
+static void formatar_hex_avx2(const uint8_t *bytes, size_t n, char *hex) {
+    const __m256i tab = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)hex_table));
+    const __m256i m4 = _mm256_set1_epi8(0x0F);
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i v = _mm256_permute4x64_epi64(_mm256_loadu_si256((const __m256i*)(bytes + i)), 0xD8);
+        __m256i hi = _mm256_shuffle_epi8(tab, _mm256_and_si256(_mm256_srli_epi16(v, 4), m4));
+        __m256i lo = _mm256_shuffle_epi8(tab, _mm256_and_si256(v, m4));
+        _mm256_storeu_si256((__m256i*)(hex + 2 * i), _mm256_unpacklo_epi8(hi, lo));
+        _mm256_storeu_si256((__m256i*)(hex + 2 * i + 32), _mm256_unpackhi_epi8(hi, lo));
     }
-    *ptr = '\0';
+    formatar_hex_escalar(bytes + i, n - i, hex + 2 * i);
+}
+#endif
 
-    free(bytes);
-    liberar_arvore(arvore);
-    free(codigos);
-    return saida;
+typedef void (*fn_formatar_hex)(const uint8_t *bytes, size_t n, char *hex);
+
+static fn_formatar_hex formatar_hex = formatar_hex_escalar;
+
+/* Converte n bytes em 2n caracteres hexadecimais (maiúsculos). */
+char* bytes_to_hex(const uint8_t *bytes, size_t n) {
+    char *hex = (char*)alocar(2 * n + 1);
+    formatar_hex(bytes, n, hex);
+    hex[2 * n] = '\0';
+    return hex;
 }
 
+/* ---------- Kernels: histograma e detecção de corridas ---------- */
 
-const char hex_table[] = "0123456789ABCDEF";
+/* Histograma com 4 sub-histogramas intercalados: corridas de bytes iguais (AA AA AA ...)
+ * não serializam incrementos no mesmo contador (store-to-load forwarding). */
+void histograma_bytes(const uint8_t *b, size_t t, int H[256]) {
+    uint32_t sub[4][256];
+    memset(sub, 0, sizeof(sub));
+    size_t i = 0;
+    for (; i + 4 <= t; i += 4) {
+        sub[0][b[i]]++;
+        sub[1][b[i + 1]]++;
+        sub[2][b[i + 2]]++;
+        sub[3][b[i + 3]]++;
+    }
+    for (; i < t; i++) sub[0][b[i]]++;
+    for (int s = 0; s < 256; s++) H[s] = (int)(sub[0][s] + sub[1][s] + sub[2][s] + sub[3][s]);
+}
 
-void bin_to_hex(char **bin) {
-    char *binary = *bin;
-    size_t len = strlen(binary);
-    if (len == 0) {
-        free(*bin);
-        *bin = strdup("0");
-        return;
+/* ---------- HUF de sequências grandes em blocos paralelos ----------
+ * A partir de HUF_PAR_MIN tokens (e com -p N) o histograma sai de um parcial por thread
+ * e o fluxo de blocos de HUF_BLOCO tokens: cada thread soma os bits dos seus blocos, a
+ * soma de prefixos dá o bit inicial de cada um e os blocos são codificados lado a lado.
+ * O byte em que dois blocos se encontram é montado depois do join (ver huf_bits). */
+#define HUF_PAR_MIN  (1u << 20)
+#define HUF_BLOCO    (1u << 18)
+#define MAX_THREADS_SEQ 64
+
+/* Roda f(args + k * tam) para k = 0..n-1: n - 1 threads novas e a atual. */
+static void em_paralelo(int n, void *(*f)(void*), void *args, size_t tam) {
+    pthread_t th[MAX_THREADS_SEQ];
+    int criadas = 1;
+    for (; criadas < n; criadas++)
+        if (pthread_create(&th[criadas], NULL, f, (char*)args + (size_t)criadas * tam) != 0) break;
+    /* Sem thread nova a atual faz o resto. */
+    for (int k = criadas; k < n; k++) f((char*)args + (size_t)k * tam);
+    f(args);
+    for (int k = 1; k < criadas; k++) pthread_join(th[k], NULL);
+}
+
+static int threads_seq(size_t t) {
+    if (OPC.threads_seq <= 1 || t < HUF_PAR_MIN) return 1;
+    size_t blocos = t / HUF_BLOCO;
+    return (size_t)OPC.threads_seq < blocos ? OPC.threads_seq : (int)blocos;
+}
+
+typedef struct parte_hist {
+    const uint8_t *b;
+    size_t t;
+    int H[256];
+} parte_hist;
+
+static void *histograma_parte(void *arg) {
+    parte_hist *p = (parte_hist*)arg;
+    histograma_bytes(p->b, p->t, p->H);
+    return NULL;
+}
+
+/* Histograma com um parcial por thread sobre fatias contíguas, somados no fim. */
+static void histograma_paralelo(const uint8_t *b, size_t t, int H[256], int n) {
+    parte_hist *partes = (parte_hist*)alocar((size_t)n * sizeof(parte_hist));
+    for (int k = 0; k < n; k++) {
+        size_t ini = t * (size_t)k / (size_t)n, fim = t * (size_t)(k + 1) / (size_t)n;
+        partes[k].b = b + ini;
+        partes[k].t = fim - ini;
+    }
+    em_paralelo(n, histograma_parte, partes, sizeof(parte_hist));
+    memset(H, 0, 256 * sizeof(int));
+    for (int k = 0; k < n; k++)
+        for (int s = 0; s < 256; s++) H[s] += partes[k].H[s];
+    free(partes);
+}
+
+/* Histograma ingênuo (referência para o --bench). */
+static void histograma_simples(const uint8_t *b, size_t t, int H[256]) {
+    memset(H, 0, 256 * sizeof(int));
+    for (size_t i = 0; i < t; i++) H[b[i]]++;
+}
+
+/* Fim da corrida: menor j > i com b[j] != b[i] (ou t). */
+static size_t fim_corrida_escalar(const uint8_t *b, size_t i, size_t t) {
+    uint8_t c = b[i];
+    size_t j = i + 1;
+    while (j < t && b[j] == c) j++;
+    return j;
+}
+
+#ifdef TEM_X86_SIMD
+static size_t fim_corrida_sse2(const uint8_t *b, size_t i, size_t t) {
+    uint8_t c = b[i];
+    size_t j = i + 1;
+    /* Corridas curtas (dados de alta entropia) resolvem no escalar, sem custo de vetor. */
+    for (size_t lim = i + 8 < t ? i + 8 : t; j < lim; j++)
+        if (b[j] != c) return j;
+    __m128i v = _mm_set1_epi8((char)c);
+    for (; j + 16 <= t; j += 16) {
+        unsigned m = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(b + j)), v));
+        if (m != 0xFFFFu) return j + (size_t)__builtin_ctz(~m);
+    }
+    while (j < t && b[j] == c) j++;
+    return j;
+}
+
+__attribute__((target("avx2")))
+static size_t fim_corrida_avx2(const uint8_t *b, size_t i, size_t t) {
+    uint8_t c = b[i];
+    size_t j = i + 1;
+    /* Corridas curtas (dados de alta entropia) resolvem no escalar, sem custo de vetor. */
+    for (size_t lim = i + 8 < t ? i + 8 : t; j < lim; j++)
+        if (b[j] != c) return j;
+    __m256i v = _mm256_set1_epi8((char)c);
+    for (; j + 32 <= t; j += 32) {
+        unsigned m = (unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(b + j)), v));
+        if (m != 0xFFFFFFFFu) return j + (size_t)__builtin_ctz(~m);
+    }
+    while (j < t && b[j] == c) j++;
+    return j;
+}
+#endif
+
+typedef size_t (*fn_fim_corrida)(const uint8_t *b, size_t i, size_t t);
+
+static fn_fim_corrida fim_corrida = fim_corrida_escalar;
+
+/* --stats com -l: bits do Huffman limitado x sem limite, somados em todas as sequências. */
+static uint64_t BITS_LIMITADO, BITS_SEM_LIMITE;
+static unsigned long SEQ_LIMITADAS;
+
+static void contar_limite(const int H[256], const uint8_t len[256]) {
+    uint64_t cod[256], com = 0, sem = 0;
+    uint8_t livre[256];
+    huffman_canonico(H, cod, livre, 0);
+    for (int s = 0; s < 256; s++) {
+        com += (uint64_t)H[s] * len[s];
+        sem += (uint64_t)H[s] * livre[s];
+    }
+    __atomic_fetch_add(&BITS_LIMITADO, com, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&BITS_SEM_LIMITE, sem, __ATOMIC_RELAXED);
+    if (com != sem) __atomic_fetch_add(&SEQ_LIMITADAS, 1, __ATOMIC_RELAXED);
+}
+
+/* Histograma e tabela de códigos da sequência; devolve o total de bits do fluxo Huffman. */
+uint64_t huf_tabela(const uint8_t *bytes, size_t t, tabela_huf *tab) {
+    int histograma[256];
+    SONDA_INICIO(t0);
+    int n = threads_seq(t);
+    if (n > 1) histograma_paralelo(bytes, t, histograma, n);
+    else histograma_bytes(bytes, t, histograma);
+    SONDA_FIM(ns_fase[ST_HISTOGRAMA], t0);
+
+    SONDA_INICIO(t1);
+    memset(tab->cod, 0, sizeof(tab->cod));
+    memset(tab->len, 0, sizeof(tab->len));
+    if (OPC.canonico) {
+        huffman_canonico(histograma, tab->cod, tab->len, OPC.limite);
+        if (OPC.limite && OPC.estatisticas) contar_limite(histograma, tab->len);
+    } else {
+        no *arvore = construir_arvore(histograma, 256);
+        tabela_codigos_iter(arvore, tab->cod, tab->len);
     }
+    SONDA_FIM(ns_fase[ST_ARVORE], t1);
+
+    uint64_t total_bits = 0;
+    for (int s = 0; s < 256; s++) total_bits += (uint64_t)histograma[s] * tab->len[s];
+    return total_bits;
+}
 
-    // Alinhamento para múltiplo de 8 bits (1 byte)
-    size_t new_len = (len + 7) / 8 * 8;
-    size_t padding = new_len - len;
-    
-    char *padded = (char*)malloc(new_len + 1);
-    // Padding à DIREITA
-    memcpy(padded, binary, len);
-    memset(padded + len, '0', padding);
-    padded[new_len] = '\0';
-
-    // Cada byte (8 bits) gera 2 caracteres hexadecimais
-    char *hex = (char*)malloc(new_len / 4 + 1);
-    for (size_t i = 0; i < new_len; i += 8) {
-        int val1 = ((padded[i] - '0') << 3) |
-                   ((padded[i+1] - '0') << 2) |
-                   ((padded[i+2] - '0') << 1) |
-                   (padded[i+3] - '0');
-        int val2 = ((padded[i+4] - '0') << 3) |
-                   ((padded[i+5] - '0') << 2) |
-                   ((padded[i+6] - '0') << 1) |
-                   (padded[i+7] - '0');
-        hex[i/4] = hex_table[val1];
-        hex[i/4 + 1] = hex_table[val2];
-    }
-    hex[new_len/4] = '\0';
-
-    free(padded);
-    free(*bin);
-    *bin = hex;
-}
-
-void corrige_HUF(char **HUF) {
-    if (strlen(*HUF) == 0) {
-        free(*HUF);
-        *HUF = strdup("0");
+/* Códigos de bytes[i..fim) no escritor, sem finalizar. Com códigos de até 32 bits
+ * (sempre o caso com -l <= 32) o acumulador nunca transborda e o laço dispensa a
+ * divisão dos códigos longos. */
+static void huf_trecho(const uint8_t *bytes, size_t i, size_t fim, const tabela_huf *tab,
+                       int curtos, escritor_bits *eb) {
+    if (curtos) {
+        for (; i < fim; i++) {
+            int len = tab->len[bytes[i]];
+            eb->acc = (eb->acc << len) | tab->cod[bytes[i]];
+            eb->n += len;
+            while (eb->n >= 8) {
+                eb->n -= 8;
+                eb->buf[eb->pos++] = (uint8_t)(eb->acc >> eb->n);
+            }
+        }
     } else {
-        bin_to_hex(HUF);
+        for (; i < fim; i++)
+            eb_escrever(eb, tab->cod[bytes[i]], tab->len[bytes[i]]);
+    }
+}
+
+typedef struct parte_huf {
+    const uint8_t *bytes;
+    const tabela_huf *tab;
+    uint8_t *buf;
+    int curtos;
+    size_t bloco_ini, bloco_fim;  /* blocos [bloco_ini, bloco_fim) desta thread */
+    size_t t, nblocos;
+    uint64_t *inicio;             /* bit inicial de cada bloco (total no fim) */
+    uint8_t *primeiro;            /* primeiro byte de cada bloco, montado após o join */
+} parte_huf;
+
+static inline size_t bloco_fim(const parte_huf *p, size_t b) {
+    return b + 1 == p->nblocos ? p->t : (b + 1) * (size_t)HUF_BLOCO;
+}
+
+/* Fase 1: bits de cada bloco da thread (inicio[b + 1] recebe o tamanho do bloco b). */
+static void *huf_contar_blocos(void *arg) {
+    parte_huf *p = (parte_huf*)arg;
+    for (size_t b = p->bloco_ini; b < p->bloco_fim; b++) {
+        uint64_t bits = 0;
+        for (size_t i = b * (size_t)HUF_BLOCO, fim = bloco_fim(p, b); i < fim; i++) bits += p->tab->len[p->bytes[i]];
+        p->inicio[b + 1] = bits;
+    }
+    return NULL;
+}
+
+/* Fase 2: cada bloco começa com o acumulador deslocado pelos bits do bloco anterior no
+ * mesmo byte (zeros). Esse primeiro byte vai para primeiro[b], já que o bloco anterior
+ * escreve o seu último byte parcial na mesma posição; o resto vai direto para buf. */
+static void *huf_codificar_blocos(void *arg) {
+    parte_huf *p = (parte_huf*)arg;
+    for (size_t b = p->bloco_ini; b < p->bloco_fim; b++) {
+        uint8_t tmp[16];
+        size_t i = b * (size_t)HUF_BLOCO, fim = bloco_fim(p, b);
+        size_t base = (size_t)(p->inicio[b] >> 3);
+        escritor_bits eb = { tmp, 0, 0, (int)(p->inicio[b] & 7) };
+        while (eb.pos == 0) {
+            eb_escrever(&eb, p->tab->cod[p->bytes[i]], p->tab->len[p->bytes[i]]);
+            i++;
+        }
+        p->primeiro[b] = tmp[0];
+        memcpy(p->buf + base + 1, tmp + 1, eb.pos - 1);
+        eb.buf = p->buf + base;
+        huf_trecho(p->bytes, i, fim, p->tab, p->curtos, &eb);
+        eb_finalizar(&eb);
+    }
+    return NULL;
+}
+
+/* Fluxo de bits em buf (ao menos (total_bits + 7) / 8 + 1 bytes); devolve o nº de bytes.
+ * Sequências grandes com -p N saem em blocos paralelos, bit a bit iguais ao serial. */
+size_t huf_bits(const uint8_t *bytes, size_t t, const tabela_huf *tab, uint8_t *buf) {
+    uint8_t max = 0;
+    for (int s = 0; s < 256; s++) max = tab->len[s] > max ? tab->len[s] : max;
+    int n = max > 0 ? threads_seq(t) : 1;  /* um só símbolo: fluxo vazio */
+    if (n <= 1) {
+        escritor_bits eb = { buf, 0, 0, 0 };
+        huf_trecho(bytes, 0, t, tab, max <= 32, &eb);
+        eb_finalizar(&eb);
+        return eb.pos;
+    }
+
+    /* Blocos de HUF_BLOCO tokens; o último absorve a sobra (tem sempre >= 8 bytes de saída,
+     * então nenhum bloco cabe inteiro dentro de um só byte). */
+    size_t nblocos = t / HUF_BLOCO;
+    uint64_t *inicio = (uint64_t*)alocar_zerado(nblocos + 1, sizeof(uint64_t));
+    uint8_t *primeiro = (uint8_t*)alocar(nblocos);
+    parte_huf *partes = (parte_huf*)alocar((size_t)n * sizeof(parte_huf));
+    for (int k = 0; k < n; k++) {
+        parte_huf p = { bytes, tab, buf, max <= 32, nblocos * (size_t)k / (size_t)n,
+                        nblocos * (size_t)(k + 1) / (size_t)n, t, nblocos, inicio, primeiro };
+        partes[k] = p;
+    }
+    em_paralelo(n, huf_contar_blocos, partes, sizeof(parte_huf));
+    for (size_t b = 0; b < nblocos; b++) inicio[b + 1] += inicio[b];
+    em_paralelo(n, huf_codificar_blocos, partes, sizeof(parte_huf));
+
+    /* Costura: alinhado, o byte é só do bloco; senão completa o byte parcial do anterior. */
+    for (size_t b = 0; b < nblocos; b++) {
+        if (inicio[b] & 7) buf[inicio[b] >> 3] |= primeiro[b];
+        else buf[inicio[b] >> 3] = primeiro[b];
+    }
+    size_t bytes_saida = (size_t)((inicio[nblocos] + 7) >> 3);
+    free(partes);
+    free(primeiro);
+    free(inicio);
+    return bytes_saida;
+}
+
+/* Codifica com a tabela pronta e devolve o fluxo de bits já em hexadecimal
+ * (preenchido com zeros até múltiplo de 8 bits; "0" quando não há bits). */
+char* huf_codificar(const uint8_t *bytes, size_t t, const tabela_huf *tab, uint64_t total_bits) {
+    if (t == 0) return strdup("0");
+
+    uint8_t *buf = (uint8_t*)alocar((size_t)((total_bits + 7) / 8) + 1);
+    char *saida = bytes_to_hex(buf, huf_bits(bytes, t, tab, buf));
+    free(buf);
+    return saida;
+}
+
+/* Codifica a sequência com Huffman (hex). Se tab != NULL, recebe a tabela de códigos usada. */
+char* HUF(const uint8_t *bytes, size_t t, tabela_huf *tab) {
+    tabela_huf local;
+    if (!tab) tab = &local;
+    uint64_t total_bits = huf_tabela(bytes, t, tab);
+    return huf_codificar(bytes, t, tab, total_bits);
+}
+
+/* Nº de grupos (contagem, byte) que o RLE emitiria: o tamanho em hex é 4 vezes isso. */
+size_t rle_grupos(const uint8_t *bytes, size_t t) {
+    size_t grupos = 0;
+    for (size_t i = 0, j; i < t; i = j) {
+        j = fim_corrida(bytes, i, t);
+        grupos += (j - i + 254) / 255;
     }
+    return grupos;
 }
 
-char* runLengthEncongind(char **strings, int t) {
+/* Pares (contagem, byte) em binário (pares com ao menos 2 * t bytes); devolve o nº de bytes. */
+size_t rle_pares(const uint8_t *bytes, size_t t, uint8_t *pares) {
+    size_t index = 0;
+    for (size_t i = 0; i < t; ) {
+        uint8_t c = bytes[i];
+        size_t j = fim_corrida(bytes, i, t);
+        /* Corridas maiores que 255 viram vários grupos de no máximo 255. */
+        for (size_t resto = j - i; resto > 0; ) {
+            int count = resto > 255 ? 255 : (int)resto;
+            pares[index++] = (uint8_t)count;
+            pares[index++] = c;
+            resto -= (size_t)count;
+        }
+        i = j;
+    }
+    return index;
+}
+
+char* runLengthEncongind(const uint8_t *bytes, size_t t) {
     if (t == 0) return strdup("");
 
-    char *saida = (char*)malloc((size_t)t * 4 + 1);
-    int index = 0;
-    int count = 1;
-    char c0 = strings[0][0], c1 = strings[0][1];
-
-    for (int i = 1; i <= t; i++) {
-        if (i == t || (strings[i][0] != c0 || strings[i][1] != c1) || count == 255) {
-            saida[index++] = hex_table[(count >> 4) & 0xF];
-            saida[index++] = hex_table[count & 0xF];
-            saida[index++] = c0;
-            saida[index++] = c1;
-            if (i < t) {
-                c0 = strings[i][0];
-                c1 = strings[i][1];
-            }
-            count = 1;
+    /* A conversão para hex é feita de uma vez no fim. */
+    uint8_t *pares = (uint8_t*)alocar(t * 2);
+    char *saida = bytes_to_hex(pares, rle_pares(bytes, t, pares));
+    free(pares);
+    return saida;
+}
+
+/* RLE adaptativo (estilo PackBits). Cabeçalho h: h < 0x80 = h + 1 literais a seguir;
+ * 0x80 <= h < 0xFF = o byte seguinte repetido h - 0x80 + 3 vezes (3..129); 0xFF = repetição
+ * longa, comprimento - 130 em LEB128 e depois o byte. Corridas de 1 e 2 bytes vão para os
+ * literais. Com out NULL só conta os bytes (estimativa exata). */
+#define RLEA_MAX_REP 129
+
+static size_t rlea_literais(uint8_t *out, size_t o, const uint8_t *lit, size_t n) {
+    while (n > 0) {
+        size_t k = n > 128 ? 128 : n;
+        if (out) { out[o] = (uint8_t)(k - 1); memcpy(out + o + 1, lit, k); }
+        o += k + 1;
+        lit += k;
+        n -= k;
+    }
+    return o;
+}
+
+size_t rlea_comprimir(const uint8_t *b, size_t t, uint8_t *out) {
+    size_t o = 0, ini_lit = 0, n_lit = 0;
+    for (size_t i = 0, j; i < t; i = j) {
+        j = fim_corrida(b, i, t);
+        size_t r = j - i;
+        if (r < 3) {
+            if (n_lit == 0) ini_lit = i;
+            n_lit += r;
+            continue;
+        }
+        o = rlea_literais(out, o, b + ini_lit, n_lit);
+        n_lit = 0;
+        if (r <= RLEA_MAX_REP) {
+            if (out) out[o] = (uint8_t)(0x80 + r - 3);
+            o++;
         } else {
-            count++;
+            if (out) out[o] = 0xFF;
+            o++;
+            for (size_t v = r - (RLEA_MAX_REP + 1); ; v >>= 7) {
+                if (out) out[o] = (uint8_t)((v & 0x7F) | (v > 0x7F ? 0x80 : 0));
+                o++;
+                if (v <= 0x7F) break;
+            }
         }
+        if (out) out[o] = b[i];
+        o++;
     }
-    saida[index] = '\0';
-    return saida;
+    return rlea_literais(out, o, b + ini_lit, n_lit);
 }
 
+/* Pior caso: tudo literal, 1 cabeçalho a cada 128 bytes. */
+#define RLEA_CAP(t) ((t) + (t) / 128 + 2)
+
 /* Parser de entrada: lê inteiro e avança p */
 static int parse_int(char **p) {
     char *s = *p;
@@ -325,96 +961,2228 @@ static int parse_int(char **p) {
     return v;
 }
 
-/* Avança p até passar de 2 chars hex e copia esses 2 chars para dest. */
-static void parse_hex2_preserve(char **p, char *dest) {
+/* Avança p até passar de 2 chars hex e devolve o byte que eles representam. */
+static inline uint8_t parse_hex_byte(char **p) {
     char *s = *p;
     while (*s == ' ' || *s == '\t' || *s == '\n' || *s == '\r') s++;
-    dest[0] = s[0];
-    dest[1] = s[1];
-    dest[2] = '\0';
     *p = s + 2;
+    return (uint8_t)HEX2BUF(s[0], s[1]);
 }
 
-int main(int argc, char* argv[]) {
-    clock_t inicio, fim;
-    double tempo_gasto;
-    inicio = clock();
-    if (argc < 3) return 1;
-
-    FILE* input = fopen(argv[1], "r");
-    if (!input) return 1;
-
-    fseek(input, 0, SEEK_END);
-    long fsize = ftell(input);
-    fseek(input, 0, SEEK_SET);
-    if (fsize <= 0 || fsize > (long)(50 << 20)) { fclose(input); return 1; }
-    size_t size = (size_t)fsize;
-    char *buf = (char*)malloc(size + 1);
-    if (!buf) { fclose(input); return 1; }
-    size_t nread = fread(buf, 1, size, input);
-    fclose(input);
-    buf[nread] = '\0';
+/* Lê t tokens de *p para out. Os kernels vetoriais exigem o layout "AA BB CC" (um espaço
+ * entre tokens) e nunca leem em limite ou além; qualquer bloco fora do padrão (espaços
+ * extras, quebra de linha, caractere não hex) é lido pelo caminho escalar. */
+static void ler_tokens_escalar(char **p, const char *limite, uint8_t *out, size_t t) {
+    (void)limite;
+    for (size_t j = 0; j < t; j++) out[j] = parse_hex_byte(p);
+}
 
-    init_hex_table();
+#ifdef TEM_X86_SIMD
+/* Nibbles de 16 caracteres e máscara dos que são hex válidos. */
+__attribute__((target("ssse3")))
+static inline __m128i nibbles_ssse3(__m128i v, int *validos) {
+    __m128i minus = _mm_or_si128(v, _mm_set1_epi8(0x20));
+    __m128i dig = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8('0' - 1)), _mm_cmpgt_epi8(_mm_set1_epi8('9' + 1), v));
+    __m128i alf = _mm_and_si128(_mm_cmpgt_epi8(minus, _mm_set1_epi8('a' - 1)), _mm_cmpgt_epi8(_mm_set1_epi8('f' + 1), minus));
+    *validos = _mm_movemask_epi8(_mm_or_si128(dig, alf));
+    return _mm_or_si128(_mm_and_si128(dig, _mm_sub_epi8(v, _mm_set1_epi8('0'))),
+                        _mm_and_si128(alf, _mm_sub_epi8(minus, _mm_set1_epi8('a' - 10))));
+}
 
-    FILE* output = fopen(argv[2], "w");
-    if (!output) { free(buf); return 1; }
-    setvbuf(output, NULL, _IOFBF, 256 * 1024);
+#define POS_HEX 0x36DB      /* bytes 0,1,3,4,6,7,9,10,12,13: 5 tokens */
+#define POS_ESPACO 0x4924   /* bytes 2,5,8,11,14: separadores */
 
-    char *p = buf;
-    int quantidade_sequencias = parse_int(&p);
+/* 5 tokens em 15 bytes; devolve 0 se o bloco não segue o layout. Grava 8 bytes em out. */
+__attribute__((target("ssse3")))
+static inline int bloco5_ssse3(const char *s, uint8_t *out) {
+    __m128i v = _mm_loadu_si128((const __m128i*)s);
+    int validos;
+    __m128i nib = nibbles_ssse3(v, &validos);
+    int esp = _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')));
+    if ((validos & POS_HEX) != POS_HEX || (esp & POS_ESPACO) != POS_ESPACO) return 0;
+    __m128i hi = _mm_shuffle_epi8(nib, _mm_setr_epi8(0, 3, 6, 9, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1));
+    __m128i lo = _mm_shuffle_epi8(nib, _mm_setr_epi8(1, 4, 7, 10, 13, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1));
+    _mm_storel_epi64((__m128i*)out, _mm_or_si128(_mm_slli_epi16(hi, 4), lo));
+    return 1;
+}
+
+/* 15 tokens (45 bytes) por iteração. */
+__attribute__((target("ssse3")))
+static void ler_tokens_ssse3(char **p, const char *limite, uint8_t *out, size_t t) {
+    char *s = *p;
+    size_t j = 0;
+    while (*s == ' ' || *s == '\t' || *s == '\n' || *s == '\r') s++;
+    while (t - j >= 18 && s + 48 <= limite) {
+        if (bloco5_ssse3(s, out + j) && bloco5_ssse3(s + 15, out + j + 5) && bloco5_ssse3(s + 30, out + j + 10)) {
+            s += 45;
+            j += 15;
+        } else {
+            for (int k = 0; k < 15; k++) out[j++] = parse_hex_byte(&s);
+            while (*s == ' ' || *s == '\t' || *s == '\n' || *s == '\r') s++;
+        }
+    }
+    *p = s;
+    ler_tokens_escalar(p, limite, out + j, t - j);
+}
+
+/* 20 tokens (60 bytes) por iteração: cada lane de 128 bits recebe um bloco de 5 tokens. */
+__attribute__((target("avx2")))
+static inline int bloco10_avx2(const char *s, uint8_t *out) {
+    __m256i v = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i*)s)),
+                                        _mm_loadu_si128((const __m128i*)(s + 15)), 1);
+    __m256i minus = _mm256_or_si256(v, _mm256_set1_epi8(0x20));
+    __m256i dig = _mm256_and_si256(_mm256_cmpgt_epi8(v, _mm256_set1_epi8('0' - 1)), _mm256_cmpgt_epi8(_mm256_set1_epi8('9' + 1), v));
+    __m256i alf = _mm256_and_si256(_mm256_cmpgt_epi8(minus, _mm256_set1_epi8('a' - 1)), _mm256_cmpgt_epi8(_mm256_set1_epi8('f' + 1), minus));
+    unsigned validos = (unsigned)_mm256_movemask_epi8(_mm256_or_si256(dig, alf));
+    unsigned esp = (unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')));
+    const unsigned hex2 = POS_HEX | ((unsigned)POS_HEX << 16), esp2 = POS_ESPACO | ((unsigned)POS_ESPACO << 16);
+    if ((validos & hex2) != hex2 || (esp & esp2) != esp2) return 0;
+    __m256i nib = _mm256_or_si256(_mm256_and_si256(dig, _mm256_sub_epi8(v, _mm256_set1_epi8('0'))),
+                                  _mm256_and_si256(alf, _mm256_sub_epi8(minus, _mm256_set1_epi8('a' - 10))));
+    __m256i hi = _mm256_shuffle_epi8(nib, _mm256_setr_epi8(0, 3, 6, 9, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                                                           0, 3, 6, 9, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1));
+    __m256i lo = _mm256_shuffle_epi8(nib, _mm256_setr_epi8(1, 4, 7, 10, 13, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                                                           1, 4, 7, 10, 13, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1));
+    __m256i b = _mm256_or_si256(_mm256_slli_epi16(hi, 4), lo);
+    _mm_storel_epi64((__m128i*)out, _mm256_castsi256_si128(b));
+    _mm_storel_epi64((__m128i*)(out + 5), _mm256_extracti128_si256(b, 1));
+    return 1;
+}
 
-    for (int i = 0; i < quantidade_sequencias; i++) {
-        sequencia Sequencia;
-        Sequencia.tamanho = parse_int(&p);
-
-        /* Buffer único: todos os tokens em um bloco contíguo */
-        char *block = (char*)malloc((size_t)Sequencia.tamanho * 3);
-        if (!block) { free(buf); fclose(output); return 1; }
-        Sequencia.conteudo = (char**)malloc((size_t)Sequencia.tamanho * sizeof(char*));
-        if (!Sequencia.conteudo) { free(block); free(buf); fclose(output); return 1; }
-        for (int j = 0; j < Sequencia.tamanho; j++) {
-            Sequencia.conteudo[j] = block + j * 3;
-            parse_hex2_preserve(&p, Sequencia.conteudo[j]);
-        }
-
-        Sequencia.conteudo_comprimido_HUFF = HUF(Sequencia.conteudo, Sequencia.tamanho);
-        corrige_HUF(&Sequencia.conteudo_comprimido_HUFF);
-        Sequencia.conteudo_comprimido_RLE = runLengthEncongind(Sequencia.conteudo, Sequencia.tamanho);
-
-        size_t len_h = strlen(Sequencia.conteudo_comprimido_HUFF);
-        size_t len_r = strlen(Sequencia.conteudo_comprimido_RLE);
-        int den = 2 * Sequencia.tamanho;
-        Sequencia.percentual_HUFF = (float)len_h * 100.f / (float)den;
-        Sequencia.percentual_RLE  = (float)len_r * 100.f / (float)den;
-
-        /* Gabarito não tem newline após a última linha; imprimir \n antes de cada linha exceto a primeira. */
-        int first_line = (i == 0);
-        if (Sequencia.percentual_HUFF < Sequencia.percentual_RLE) {
-            if (!first_line) fputc('\n', output);
-            fprintf(output, "%d->HUF(%.2f%%)=%s", i, Sequencia.percentual_HUFF, Sequencia.conteudo_comprimido_HUFF);
-            first_line = 0;
-        } else if (Sequencia.percentual_HUFF > Sequencia.percentual_RLE) {
-            if (!first_line) fputc('\n', output);
-            fprintf(output, "%d->RLE(%.2f%%)=%s", i, Sequencia.percentual_RLE, Sequencia.conteudo_comprimido_RLE);
-            first_line = 0;
+__attribute__((target("avx2")))
+static void ler_tokens_avx2(char **p, const char *limite, uint8_t *out, size_t t) {
+    char *s = *p;
+    size_t j = 0;
+    while (*s == ' ' || *s == '\t' || *s == '\n' || *s == '\r') s++;
+    while (t - j >= 23 && s + 63 <= limite) {
+        if (bloco10_avx2(s, out + j) && bloco10_avx2(s + 30, out + j + 10)) {
+            s += 60;
+            j += 20;
         } else {
-            if (!first_line) fputc('\n', output);
-            fprintf(output, "%d->HUF(%.2f%%)=%s\n%d->RLE(%.2f%%)=%s", i, Sequencia.percentual_HUFF, Sequencia.conteudo_comprimido_HUFF, i, Sequencia.percentual_RLE, Sequencia.conteudo_comprimido_RLE);
-            first_line = 0;
+            for (int k = 0; k < 20; k++) out[j++] = parse_hex_byte(&s);
+            while (*s == ' ' || *s == '\t' || *s == '\n' || *s == '\r') s++;
+        }
+    }
+    *p = s;
+    ler_tokens_escalar(p, limite, out + j, t - j);
+}
+#endif
+
+typedef void (*fn_ler_tokens)(char **p, const char *limite, uint8_t *out, size_t t);
+
+static fn_ler_tokens ler_tokens = ler_tokens_escalar;
+
+/* Escolhe os kernels pela CPU (CPUID); chamado uma vez em main(). */
+static void init_kernels(void) {
+#ifdef TEM_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        fim_corrida = fim_corrida_avx2;
+        formatar_hex = formatar_hex_avx2;
+        ler_tokens = ler_tokens_avx2;
+    } else if (__builtin_cpu_supports("ssse3")) {
+        fim_corrida = fim_corrida_sse2;
+        formatar_hex = formatar_hex_ssse3;
+        ler_tokens = ler_tokens_ssse3;
+    } else if (__builtin_cpu_supports("sse2")) {
+        fim_corrida = fim_corrida_sse2;
+    }
+#endif
+}
+
+/* ---------- Saída de texto: buffer próprio em vez de stdio ----------
+ * Inteiros e percentuais formatados à mão direto no buffer; payloads grandes vão junto com
+ * o buffer pendente num único writev, sem cópia. Só a thread escritora usa. */
+
+#define SAIDA_TEXTO_SZ (1u << 20)
+#define SAIDA_WRITEV_MIN (64u << 10)   /* payloads a partir daqui não são copiados */
+
+typedef struct saida_texto {
+    int fd;
+    char *buf;
+    size_t pos;
+    int erro;
+} saida_texto;
+
+/* Escreve os iovecs por inteiro (writev pode escrever só parte). */
+static void st_writev(saida_texto *w, struct iovec *v, int n) {
+    for (;;) {
+        while (n > 0 && v->iov_len == 0) { v++; n--; }
+        if (n == 0 || w->erro) return;
+        ssize_t r = writev(w->fd, v, n);
+        if (r <= 0) { w->erro = 1; return; }
+        for (size_t k = (size_t)r; k > 0; ) {
+            size_t d = k < v->iov_len ? k : v->iov_len;
+            v->iov_base = (char*)v->iov_base + d;
+            v->iov_len -= d;
+            k -= d;
+            if (v->iov_len == 0) { v++; n--; }
         }
+    }
+}
+
+static void st_descarregar(saida_texto *w) {
+    struct iovec v = { w->buf, w->pos };
+    st_writev(w, &v, 1);
+    w->pos = 0;
+}
 
-        free(block);
-        free(Sequencia.conteudo);
-        free(Sequencia.conteudo_comprimido_HUFF);
-        free(Sequencia.conteudo_comprimido_RLE);
+/* Garante n bytes livres no buffer (n <= SAIDA_TEXTO_SZ) e devolve onde escrever. */
+static inline char *st_reservar(saida_texto *w, size_t n) {
+    if (SAIDA_TEXTO_SZ - w->pos < n) st_descarregar(w);
+    return w->buf + w->pos;
+}
+
+static void st_escrever(saida_texto *w, const char *s, size_t n) {
+    if (n >= SAIDA_WRITEV_MIN) {
+        struct iovec v[2] = { { w->buf, w->pos }, { (void*)s, n } };
+        st_writev(w, v, 2);
+        w->pos = 0;
+        return;
     }
+    memcpy(st_reservar(w, n), s, n);
+    w->pos += n;
+}
 
-    free(buf);
-    fclose(output);
-    fim = clock();
-    tempo_gasto = (double)(fim - inicio) / CLOCKS_PER_SEC;
-    printf("Tempo de execucao: %f segundos\n", tempo_gasto);
-    printf("Saída escrita em: %s\n", argv[2]);
+static inline void st_char(saida_texto *w, char c) {
+    *st_reservar(w, 1) = c;
+    w->pos++;
+}
+
+static void st_uint(saida_texto *w, uint64_t v) {
+    char tmp[20];
+    int n = 0;
+    do { tmp[n++] = (char)('0' + v % 10); v /= 10; } while (v);
+    char *o = st_reservar(w, (size_t)n);
+    for (int k = 0; k < n; k++) o[k] = tmp[n - 1 - k];
+    w->pos += (size_t)n;
+}
+
+/* Mesmo texto que printf("%.2f", v): o valor binário exato de v vezes 100, arredondado ao
+ * inteiro mais próximo com empate para o par, como a glibc. Fora da faixa (negativo, muito
+ * grande, inf/nan) cai no snprintf. */
+static void st_percentual(saida_texto *w, float v) {
+    uint32_t b;
+    memcpy(&b, &v, sizeof(b));
+    int e = (int)((b >> 23) & 0xFF);
+    uint64_t m = b & 0x7FFFFF, q;
+    if (e) m |= 0x800000;
+    e = e ? e - 150 : -149;                  /* v = m * 2^e */
+    if ((b >> 31) || e > 32 || ((b >> 23) & 0xFF) == 0xFF) {
+        char tmp[64];
+        st_escrever(w, tmp, (size_t)snprintf(tmp, sizeof(tmp), "%.2f", (double)v));
+        return;
+    }
+    m *= 100;                                /* < 2^31 */
+    if (e >= 0) q = m << e;
+    else if (e < -40) q = 0;                 /* v * 100 < 1/2 */
+    else {
+        uint64_t meio = 1ull << (-e - 1), r = m & ((meio << 1) - 1);
+        q = m >> -e;
+        if (r > meio || (r == meio && (q & 1))) q++;
+    }
+    st_uint(w, q / 100);
+    char *o = st_reservar(w, 3);
+    o[0] = '.';
+    o[1] = (char)('0' + q % 100 / 10);
+    o[2] = (char)('0' + q % 10);
+    w->pos += 3;
+}
+
+static int st_abrir(saida_texto *w, int fd) {
+    w->fd = fd;
+    w->pos = 0;
+    w->erro = 0;
+    w->buf = (char*)alocar(SAIDA_TEXTO_SZ);
+    return w->buf ? 0 : -1;
+}
+
+/* Descarrega e libera o buffer (o fd fica com quem abriu). Devolve -1 se algo falhou. */
+static int st_fechar(saida_texto *w) {
+    st_descarregar(w);
+    free(w->buf);
+    w->buf = NULL;
+    return w->erro ? -1 : 0;
+}
+
+/* Linha "i->CAN(t)=SSLL..." com símbolo e comprimento canônico (2 hex cada) dos símbolos usados. */
+static void escrever_comprimentos(saida_texto *output, int i, int t, const uint8_t len[256]) {
+    st_char(output, '\n');
+    st_uint(output, (uint64_t)i);
+    st_escrever(output, "->CAN(", 6);
+    st_uint(output, (uint64_t)t);
+    st_escrever(output, ")=", 2);
+    char *o = st_reservar(output, 4 * 256);
+    for (int s = 0; s < 256; s++) {
+        if (!len[s]) continue;
+        *o++ = hex_table[s >> 4];
+        *o++ = hex_table[s & 0xF];
+        *o++ = hex_table[len[s] >> 4];
+        *o++ = hex_table[len[s] & 0xF];
+    }
+    output->pos = (size_t)(o - output->buf);
+}
+
+/* Entrada mapeada com mmap (leitura sequencial), sempre seguida de um '\0'.
+ * As páginas já consumidas são devolvidas ao kernel, então a memória residente
+ * acompanha as sequências em processamento e não o tamanho do arquivo.
+ * Se o mmap não for possível (pipe, etc.), lê tudo para um buffer do malloc. */
+typedef struct entrada {
+    char *dados;
+    size_t tam;
+    size_t reservado;   /* tamanho da reserva do mmap (0 = buffer do malloc) */
+    size_t liberado;    /* prefixo já devolvido com MADV_DONTNEED */
+} entrada;
+
+#define LIBERAR_A_CADA (4u << 20)
+
+static int abrir_entrada(const char *nome, entrada *e) {
+    memset(e, 0, sizeof(*e));
+    int fd = open(nome, O_RDONLY);
+    if (fd < 0) return -1;
+    struct stat st;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        size_t pg = (size_t)sysconf(_SC_PAGESIZE);
+        size_t tam = (size_t)st.st_size;
+        size_t res = (tam + 1 + pg - 1) / pg * pg;
+        /* Reserva anônima (zerada) de tam+1 bytes e o arquivo mapeado por cima: o byte após o fim é '\0'. */
+        char *base = (char*)mmap(NULL, res, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (base != MAP_FAILED) {
+            if (mmap(base, tam, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0) != MAP_FAILED) {
+                madvise(base, tam, MADV_SEQUENTIAL);
+                close(fd);
+                e->dados = base;
+                e->tam = tam;
+                e->reservado = res;
+                return 0;
+            }
+            munmap(base, res);
+        }
+    }
+    size_t cap = 1 << 20, n = 0;
+    char *buf = (char*)alocar(cap + 1);
+    ssize_t r;
+    while (buf && (r = read(fd, buf + n, cap - n)) > 0) {
+        n += (size_t)r;
+        if (n == cap) {
+            cap *= 2;
+            char *novo = (char*)realocar(buf, cap + 1);
+            if (!novo) { free(buf); buf = NULL; }
+            buf = novo;
+        }
+    }
+    close(fd);
+    if (!buf) return -1;
+    buf[n] = '\0';
+    e->dados = buf;
+    e->tam = n;
+    return 0;
+}
+
+/* Devolve ao kernel as páginas inteiras antes de "ate" (só no modo mmap). */
+static void liberar_consumido(entrada *e, const char *ate) {
+    if (!e->reservado) return;
+    size_t pg = (size_t)sysconf(_SC_PAGESIZE);
+    size_t n = (size_t)(ate - e->dados) / pg * pg;
+    if (n < e->liberado + LIBERAR_A_CADA) return;
+    madvise(e->dados + e->liberado, n - e->liberado, MADV_DONTNEED);
+    e->liberado = n;
+}
+
+static void fechar_entrada(entrada *e) {
+    if (e->reservado) munmap(e->dados, e->reservado);
+    else free(e->dados);
+}
+
+/* ---------- Decodificação (modo -d e --verify) ---------- */
+
+/* Converte n caracteres hex (n par) em n/2 bytes. Devolve -1 se houver caractere inválido. */
+static long hex_para_bytes(const char *hex, size_t n, uint8_t *saida) {
+    for (size_t i = 0; i + 1 < n; i += 2) {
+        unsigned char a = (unsigned char)hex[i], b = (unsigned char)hex[i + 1];
+        if ((!hex_byte[a] && a != '0') || (!hex_byte[b] && b != '0')) return -1;
+        saida[i / 2] = (uint8_t)HEX2BUF(a, b);
+    }
+    return (long)(n / 2);
+}
+
+/* Decodifica o payload RLE (grupos CCSS em hex). Devolve o nº de bytes gerados ou -1. */
+long rle_decodificar(const char *hex, size_t n, uint8_t *saida, size_t cap) {
+    if (n % 4) return -1;
+    size_t k = 0;
+    for (size_t i = 0; i < n; i += 4) {
+        uint8_t par[2];
+        if (hex_para_bytes(hex + i, 4, par) < 0 || par[0] == 0) return -1;
+        if (k + par[0] > cap) return -1;
+        memset(saida + k, par[1], par[0]);
+        k += par[0];
+    }
+    return (long)k;
+}
+
+/* Decodifica o RLE adaptativo; com saida NULL só valida e mede. Devolve o tamanho ou -1. */
+long rlea_descomprimir(const uint8_t *in, size_t n, uint8_t *saida) {
+    size_t ip = 0, op = 0;
+    while (ip < n) {
+        uint8_t h = in[ip++];
+        if (h < 0x80) {
+            size_t k = (size_t)h + 1;
+            if (k > n - ip) return -1;
+            if (saida) memcpy(saida + op, in + ip, k);
+            ip += k;
+            op += k;
+            continue;
+        }
+        size_t r = (size_t)h - 0x80 + 3;
+        if (h == 0xFF) {
+            uint64_t v = 0;
+            int desl = 0;
+            for (;;) {
+                if (ip >= n || desl > 56) return -1;
+                uint8_t c = in[ip++];
+                v |= (uint64_t)(c & 0x7F) << desl;
+                desl += 7;
+                if (!(c & 0x80)) break;
+            }
+            if (v > (uint64_t)(LONG_MAX / 2)) return -1;
+            r = (size_t)v + RLEA_MAX_REP + 1;
+        }
+        if (ip >= n) return -1;
+        if (saida) memset(saida + op, in[ip], r);
+        ip++;
+        op += r;
+        if (op > (size_t)LONG_MAX / 2) return -1;
+    }
+    return (long)op;
+}
+
+#define DEC_BITS 11
+#define DEC_INVALIDO 0xFFFFFFFFu
+
+/* Decodificador por tabela: um acesso resolve qualquer código de até DEC_BITS bits.
+ * Entrada da tabela: símbolo | (len << 8); len 0 indica código longo e os bits 16..31
+ * guardam o nó da trie onde a descida continua bit a bit. Serve para qualquer código
+ * de prefixo (árvore ou canônico). */
+typedef struct decodificador_huf {
+    uint32_t tab[1 << DEC_BITS];
+    int16_t filho[512][2];   /* >= 0: nó interno; < 0: folha -(símbolo + 1); 0 em filho = vazio */
+    int nos;
+} decodificador_huf;
+
+static int dec_montar(decodificador_huf *d, const tabela_huf *t) {
+    memset(d->filho, 0, sizeof(d->filho));
+    d->nos = 1;
+    for (int i = 0; i < (1 << DEC_BITS); i++) d->tab[i] = DEC_INVALIDO;
+
+    for (int s = 0; s < 256; s++) {
+        int l = t->len[s];
+        if (!l) continue;
+        int n = 0;
+        for (int b = l - 1; b >= 0; b--) {
+            int bit = (int)((t->cod[s] >> b) & 1);
+            int f = d->filho[n][bit];
+            if (f < 0) return -1;                     /* prefixo de outro código */
+            if (b == 0) {
+                if (f > 0) return -1;
+                d->filho[n][bit] = (int16_t)-(s + 1);
+            } else {
+                if (f == 0) {
+                    if (d->nos >= 512) return -1;
+                    f = d->filho[n][bit] = (int16_t)d->nos++;
+                }
+                n = f;
+            }
+        }
+        if (l <= DEC_BITS) {
+            uint32_t base = (uint32_t)(t->cod[s] << (DEC_BITS - l));
+            uint32_t e = (uint32_t)s | ((uint32_t)l << 8);
+            for (uint32_t k = 0; k < (1u << (DEC_BITS - l)); k++) d->tab[base + k] = e;
+        }
+    }
+    /* Prefixos de códigos longos apontam para o nó interno alcançado após DEC_BITS bits. */
+    for (int s = 0; s < 256; s++) {
+        int l = t->len[s];
+        if (l <= DEC_BITS) continue;
+        uint32_t pre = (uint32_t)(t->cod[s] >> (l - DEC_BITS));
+        int n = 0;
+        for (int b = DEC_BITS - 1; b >= 0; b--) n = d->filho[n][(pre >> b) & 1];
+        d->tab[pre] = (uint32_t)n << 16;
+    }
+    return 0;
+}
+
+/* Decodifica t símbolos de dados[0..nbytes). Devolve 0 ou -1 (fluxo inválido/curto). */
+int huf_decodificar(const decodificador_huf *d, const uint8_t *dados, size_t nbytes, uint8_t *saida, size_t t) {
+    uint64_t acc = 0;
+    int cnt = 0;
+    size_t pos = 0;
+    uint64_t consumidos = 0, disponiveis = (uint64_t)nbytes * 8;
+
+    for (size_t i = 0; i < t; i++) {
+        while (cnt <= 56) {
+            uint64_t b = pos < nbytes ? dados[pos] : 0;
+            pos++;
+            acc |= b << (56 - cnt);
+            cnt += 8;
+        }
+        uint32_t e = d->tab[acc >> (64 - DEC_BITS)];
+        if (e == DEC_INVALIDO) return -1;
+        int l = (int)((e >> 8) & 0xFF);
+        if (l) {
+            saida[i] = (uint8_t)e;
+            acc <<= l;
+            cnt -= l;
+            consumidos += (uint64_t)l;
+        } else {
+            int n = (int)(e >> 16);
+            acc <<= DEC_BITS;
+            cnt -= DEC_BITS;
+            consumidos += DEC_BITS;
+            for (;;) {
+                if (cnt == 0) {
+                    uint64_t b = pos < nbytes ? dados[pos] : 0;
+                    pos++;
+                    acc = b << 56;
+                    cnt = 8;
+                }
+                int f = d->filho[n][acc >> 63];
+                acc <<= 1;
+                cnt--;
+                consumidos++;
+                if (f < 0) { saida[i] = (uint8_t)(-f - 1); break; }
+                if (f == 0) return -1;
+                n = f;
+            }
+        }
+        if (consumidos > disponiveis) return -1;
+    }
+    return 0;
+}
+
+/* Lê "i->NOME(...)=payload" a partir de p. Devolve o ponteiro para o início da próxima linha. */
+static char *ler_linha_saida(char *p, int *idx, char tipo[8], char **arg, char **payload, size_t *n) {
+    *idx = parse_int(&p);
+    if (p[0] != '-' || p[1] != '>') return NULL;
+    p += 2;
+    int k = 0;
+    while (*p && *p != '(' && k < 7) tipo[k++] = *p++;
+    tipo[k] = '\0';
+    if (*p != '(') return NULL;
+    *arg = ++p;
+    while (*p && *p != '=') p++;
+    if (*p != '=') return NULL;
+    *payload = ++p;
+    while (*p && *p != '\n' && *p != '\r') p++;
+    *n = (size_t)(p - *payload);
+    while (*p == '\n' || *p == '\r') p++;
+    return p;
+}
+
+static void escrever_sequencia(FILE *output, const uint8_t *bytes, size_t t) {
+    fprintf(output, "%zu", t);
+    for (size_t j = 0; j < t; j++) {
+        fputc(' ', output);
+        fputc(hex_table[bytes[j] >> 4], output);
+        fputc(hex_table[bytes[j] & 0xF], output);
+    }
+    fputc('\n', output);
+}
+
+/* ---------- LZ77 com cadeias de hash ---------- */
+
+/* Formato em sequências ao estilo LZ4: token (literais << 4 | comprimento - LZ_MIN),
+ * extensões de 255 quando o campo vale 15, literais, deslocamento de 2 bytes (LE) e
+ * extensão do comprimento. A última sequência só tem literais (pode ter zero). */
+#define LZ_MIN 4
+#define LZ_JANELA 65535
+#define LZ_HASH_BITS 12
+#define LZ_CADEIA 32
+
+static inline uint32_t lz_hash(const uint8_t *p) {
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return (v * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+static uint8_t *lz_estender(uint8_t *o, size_t n) {
+    for (; n >= 255; n -= 255) *o++ = 255;
+    *o++ = (uint8_t)n;
+    return o;
+}
+
+static uint8_t *lz_sequencia(uint8_t *o, const uint8_t *lit, size_t n_lit, size_t dist, size_t comp) {
+    size_t m = comp ? comp - LZ_MIN : 0;
+    *o++ = (uint8_t)(((n_lit < 15 ? n_lit : 15) << 4) | (m < 15 ? m : 15));
+    if (n_lit >= 15) o = lz_estender(o, n_lit - 15);
+    memcpy(o, lit, n_lit);
+    o += n_lit;
+    if (!comp) return o;
+    *o++ = (uint8_t)dist;
+    *o++ = (uint8_t)(dist >> 8);
+    if (m >= 15) o = lz_estender(o, m - 15);
+    return o;
+}
+
+uint8_t *lz77_comprimir(const uint8_t *b, size_t t, size_t *n_saida) {
+    uint8_t *saida = (uint8_t*)alocar(t + t / 255 + 16);
+    uint8_t *o = saida;
+    int32_t cabeca[1 << LZ_HASH_BITS];
+    int32_t *ant = (int32_t*)alocar((t + 1) * sizeof(int32_t));
+    for (int k = 0; k < (1 << LZ_HASH_BITS); k++) cabeca[k] = -1;
+
+    size_t i = 0, lit = 0;
+    while (i + LZ_MIN <= t) {
+        uint32_t h = lz_hash(b + i);
+        int32_t cand = cabeca[h];
+        ant[i] = cand;
+        cabeca[h] = (int32_t)i;
+
+        size_t melhor = 0, dist = 0;
+        for (int prof = LZ_CADEIA; cand >= 0 && i - (size_t)cand <= LZ_JANELA && prof > 0; prof--, cand = ant[cand]) {
+            if (i + melhor < t && b[(size_t)cand + melhor] != b[i + melhor]) continue;
+            size_t l = 0;
+            while (i + l < t && b[(size_t)cand + l] == b[i + l]) l++;
+            if (l > melhor) { melhor = l; dist = i - (size_t)cand; }
+            if (i + l == t) break;
+        }
+        if (melhor < LZ_MIN) { i++; continue; }
+
+        o = lz_sequencia(o, b + lit, i - lit, dist, melhor);
+        for (size_t k = i + 1; k < i + melhor && k + LZ_MIN <= t; k++) {
+            h = lz_hash(b + k);
+            ant[k] = cabeca[h];
+            cabeca[h] = (int32_t)k;
+        }
+        i += melhor;
+        lit = i;
+    }
+    o = lz_sequencia(o, b + lit, t - lit, 0, 0);
+    free(ant);
+    *n_saida = (size_t)(o - saida);
+    return saida;
+}
+
+/* Com saida == NULL só conta (e valida) o tamanho descomprimido. Devolve -1 se inválido. */
+long lz77_descomprimir(const uint8_t *in, size_t n, uint8_t *saida) {
+    size_t ip = 0, op = 0;
+    for (;;) {
+        if (ip >= n) return -1;
+        uint8_t tok = in[ip++];
+        size_t n_lit = tok >> 4, m = tok & 15;
+        if (n_lit == 15) {
+            uint8_t x;
+            do { if (ip >= n) return -1; x = in[ip++]; n_lit += x; } while (x == 255);
+        }
+        if (ip + n_lit > n) return -1;
+        if (saida) memcpy(saida + op, in + ip, n_lit);
+        ip += n_lit;
+        op += n_lit;
+        if (ip == n) return m ? -1 : (long)op;   /* só a última sequência termina sem match */
+
+        if (ip + 2 > n) return -1;
+        size_t dist = (size_t)in[ip] | ((size_t)in[ip + 1] << 8);
+        ip += 2;
+        if (m == 15) {
+            uint8_t x;
+            do { if (ip >= n) return -1; x = in[ip++]; m += x; } while (x == 255);
+        }
+        size_t comp = m + LZ_MIN;
+        if (dist == 0 || dist > op) return -1;
+        if (saida)
+            for (size_t k = 0; k < comp; k++) saida[op + k] = saida[op - dist + k];
+        op += comp;
+    }
+}
+
+/* ---------- Codificador de faixa (range coder) adaptativo de ordem 0 ---------- */
+
+/* Range coder binário (estilo LZMA) e cada byte codificado como 8 decisões numa árvore
+ * de 255 probabilidades adaptativas de 11 bits. Payload: t em 4 bytes (big-endian) + fluxo. */
+#define RC_PROB_BITS 11
+#define RC_ADAPT 5
+#define RC_TOPO (1u << 24)
+/* Com probabilidade máxima de 2017/2048 cada byte custa ao menos ~0,18 bit do fluxo, ou
+ * seja, ~46 bytes de saída por byte de entrada; t acima disso só num payload forjado. */
+#define RC_EXPANSAO_MAX 64
+
+typedef struct codificador_faixa {
+    uint64_t low;
+    uint32_t range;
+    uint8_t cache;
+    uint64_t pendentes;
+    uint8_t *buf;
+    size_t pos, cap;
+} codificador_faixa;
+
+static void rc_byte(codificador_faixa *rc, uint8_t b) {
+    if (rc->pos == rc->cap) {
+        rc->cap *= 2;
+        rc->buf = (uint8_t*)realocar(rc->buf, rc->cap);
+    }
+    rc->buf[rc->pos++] = b;
+}
+
+static void rc_deslocar(codificador_faixa *rc) {
+    if ((uint32_t)rc->low < 0xFF000000u || (rc->low >> 32) != 0) {
+        uint8_t carry = (uint8_t)(rc->low >> 32);
+        uint8_t tmp = rc->cache;
+        do {
+            rc_byte(rc, (uint8_t)(tmp + carry));
+            tmp = 0xFF;
+        } while (--rc->pendentes != 0);
+        rc->cache = (uint8_t)(rc->low >> 24);
+    }
+    rc->pendentes++;
+    rc->low = (rc->low & 0x00FFFFFFu) << 8;
+}
+
+static inline void rc_bit(codificador_faixa *rc, uint16_t *p, int bit) {
+    uint32_t limite = (rc->range >> RC_PROB_BITS) * *p;
+    if (!bit) {
+        rc->range = limite;
+        *p += (uint16_t)(((1u << RC_PROB_BITS) - *p) >> RC_ADAPT);
+    } else {
+        rc->low += limite;
+        rc->range -= limite;
+        *p -= (uint16_t)(*p >> RC_ADAPT);
+    }
+    while (rc->range < RC_TOPO) {
+        rc->range <<= 8;
+        rc_deslocar(rc);
+    }
+}
+
+uint8_t *rc_comprimir(const uint8_t *b, size_t t, size_t *n_saida) {
+    codificador_faixa rc = { 0, 0xFFFFFFFFu, 0, 1, NULL, 0, t + 64 };
+    rc.buf = (uint8_t*)alocar(rc.cap);
+    for (int k = 3; k >= 0; k--) rc_byte(&rc, (uint8_t)((uint64_t)t >> (8 * k)));
+    uint16_t prob[256];
+    for (int k = 0; k < 256; k++) prob[k] = 1u << (RC_PROB_BITS - 1);
+    for (size_t i = 0; i < t; i++) {
+        unsigned m = 1;
+        for (int k = 7; k >= 0; k--) {
+            int bit = (b[i] >> k) & 1;
+            rc_bit(&rc, &prob[m], bit);
+            m = (m << 1) | (unsigned)bit;
+        }
+    }
+    for (int k = 0; k < 5; k++) rc_deslocar(&rc);
+    *n_saida = rc.pos;
+    return rc.buf;
+}
+
+/* Devolve t (lido do cabeçalho) e aloca *saida, ou -1 se o payload for inválido. */
+long rc_descomprimir(const uint8_t *in, size_t n, uint8_t **saida) {
+    *saida = NULL;
+    if (n < 9) return -1;
+    size_t t = ((size_t)in[0] << 24) | ((size_t)in[1] << 16) | ((size_t)in[2] << 8) | in[3];
+    if (t > n * RC_EXPANSAO_MAX) return -1;
+    size_t ip = 4;
+    uint32_t range = 0xFFFFFFFFu, code = 0;
+    for (int k = 0; k < 5; k++) code = (code << 8) | in[ip++];
+    uint16_t prob[256];
+    for (int k = 0; k < 256; k++) prob[k] = 1u << (RC_PROB_BITS - 1);
+    *saida = (uint8_t*)alocar(t + 1);
+    if (!*saida) return -1;
+    for (size_t i = 0; i < t; i++) {
+        unsigned m = 1;
+        while (m < 256) {
+            uint16_t *p = &prob[m];
+            uint32_t limite = (range >> RC_PROB_BITS) * *p;
+            if (code < limite) {
+                range = limite;
+                *p += (uint16_t)(((1u << RC_PROB_BITS) - *p) >> RC_ADAPT);
+                m <<= 1;
+            } else {
+                code -= limite;
+                range -= limite;
+                *p -= (uint16_t)(*p >> RC_ADAPT);
+                m = (m << 1) | 1;
+            }
+            while (range < RC_TOPO) {
+                range <<= 8;
+                code = (code << 8) | (ip < n ? in[ip] : 0);
+                ip++;
+            }
+        }
+        if (ip > n + 4) {
+            free(*saida);
+            *saida = NULL;
+            return -1;
+        }
+        (*saida)[i] = (uint8_t)m;
+    }
+    return (long)t;
+}
+
+/* ---------- Interface de codecs ---------- */
+
+/* Contexto de decodificação: tabela de códigos (HUF), nº de bytes esperado e área de trabalho. */
+typedef struct ctx_decod {
+    const tabela_huf *tab;
+    size_t t;
+    decodificador_huf *d;
+} ctx_decod;
+
+/* Um codec da ferramenta. estimar (opcional) devolve o tamanho exato do payload em hex
+ * sem gerá-lo; preparar (opcional) calcula o estado que estimar e codificar compartilham.
+ * bruto/decodificar_bruto são o payload binário do contêiner -b. */
+typedef struct codec {
+    const char *nome;
+    void (*preparar)(sequencia *seq);
+    size_t (*estimar)(sequencia *seq);
+    char *(*codificar)(sequencia *seq);
+    long (*decodificar)(const char *hex, size_t n, const ctx_decod *ctx, uint8_t **saida);
+    uint8_t *(*bruto)(sequencia *seq, size_t *n);
+    long (*decodificar_bruto)(const uint8_t *in, size_t n, const ctx_decod *ctx, uint8_t **saida);
+} codec;
+
+static void huf_preparar(sequencia *seq) {
+    seq->bits_huf = huf_tabela(seq->conteudo, (size_t)seq->tamanho, &seq->tab);
+}
+
+static size_t huf_estimar(sequencia *seq) {
+    return seq->tamanho ? (size_t)((seq->bits_huf + 7) / 8) * 2 : 1;
+}
+
+static char *huf_codec_codificar(sequencia *seq) {
+    return huf_codificar(seq->conteudo, (size_t)seq->tamanho, &seq->tab, seq->bits_huf);
+}
+
+static uint8_t *huf_bruto(sequencia *seq, size_t *n) {
+    uint8_t *buf = (uint8_t*)alocar((size_t)((seq->bits_huf + 7) / 8) + 1);
+    *n = huf_bits(seq->conteudo, (size_t)seq->tamanho, &seq->tab, buf);
+    return buf;
+}
+
+static long huf_decodificar_bruto(const uint8_t *in, size_t n, const ctx_decod *ctx, uint8_t **saida) {
+    *saida = (uint8_t*)alocar(ctx->t + 1);
+    if (ctx->t == 0) return 0;
+    if (!ctx->tab || dec_montar(ctx->d, ctx->tab) != 0 || huf_decodificar(ctx->d, in, n, *saida, ctx->t) != 0) return -1;
+    return (long)ctx->t;
+}
+
+static long huf_codec_decodificar(const char *hex, size_t n, const ctx_decod *ctx, uint8_t **saida) {
+    if (ctx->t == 0 || n % 2) return ctx->t == 0 ? huf_decodificar_bruto(NULL, 0, ctx, saida) : -1;
+    uint8_t *dados = (uint8_t*)alocar(n / 2 + 1);
+    long r = -1;
+    *saida = NULL;
+    if (hex_para_bytes(hex, n, dados) >= 0) r = huf_decodificar_bruto(dados, n / 2, ctx, saida);
+    free(dados);
+    return r;
+}
+
+static size_t rle_estimar(sequencia *seq) {
+    return rle_grupos(seq->conteudo, (size_t)seq->tamanho) * 4;
+}
+
+static char *rle_codec_codificar(sequencia *seq) {
+    return runLengthEncongind(seq->conteudo, (size_t)seq->tamanho);
+}
+
+static long rle_codec_decodificar(const char *hex, size_t n, const ctx_decod *ctx, uint8_t **saida) {
+    (void)ctx;
+    size_t cap = n / 4 * 255;
+    *saida = (uint8_t*)alocar(cap + 1);
+    return rle_decodificar(hex, n, *saida, cap);
+}
+
+static uint8_t *rle_bruto(sequencia *seq, size_t *n) {
+    uint8_t *pares = (uint8_t*)alocar(2 * (size_t)seq->tamanho + 1);
+    *n = rle_pares(seq->conteudo, (size_t)seq->tamanho, pares);
+    return pares;
+}
+
+static long rle_decodificar_bruto(const uint8_t *in, size_t n, const ctx_decod *ctx, uint8_t **saida) {
+    (void)ctx;
+    *saida = (uint8_t*)alocar(n / 2 * 255 + 1);
+    if (n % 2) return -1;
+    size_t k = 0;
+    for (size_t i = 0; i < n; i += 2) {
+        if (in[i] == 0) return -1;
+        memset(*saida + k, in[i + 1], in[i]);
+        k += in[i];
+    }
+    return (long)k;
+}
+
+static uint8_t *lz77_bruto(sequencia *seq, size_t *n) {
+    return lz77_comprimir(seq->conteudo, (size_t)seq->tamanho, n);
+}
+
+static long lz77_decodificar_bruto(const uint8_t *in, size_t n, const ctx_decod *ctx, uint8_t **saida) {
+    (void)ctx;
+    *saida = NULL;
+    long r = lz77_descomprimir(in, n, NULL);
+    if (r >= 0) {
+        *saida = (uint8_t*)alocar((size_t)r + 1);
+        lz77_descomprimir(in, n, *saida);
+    }
+    return r;
+}
+
+static uint8_t *rc_bruto(sequencia *seq, size_t *n) {
+    return rc_comprimir(seq->conteudo, (size_t)seq->tamanho, n);
+}
+
+static long rc_decodificar_bruto(const uint8_t *in, size_t n, const ctx_decod *ctx, uint8_t **saida) {
+    (void)ctx;
+    return rc_descomprimir(in, n, saida);
+}
+
+/* Payload em hex dos codecs sem caso especial: o binário convertido. */
+static char *hex_de_bruto(uint8_t *(*bruto)(sequencia*, size_t*), sequencia *seq) {
+    size_t n;
+    uint8_t *buf = bruto(seq, &n);
+    char *hex = bytes_to_hex(buf, n);
+    free(buf);
+    return hex;
+}
+
+static long bruto_de_hex(long (*dec)(const uint8_t*, size_t, const ctx_decod*, uint8_t**),
+                         const char *hex, size_t n, const ctx_decod *ctx, uint8_t **saida) {
+    *saida = NULL;
+    if (n % 2) return -1;
+    uint8_t *dados = (uint8_t*)alocar(n / 2 + 1);
+    long r = -1;
+    if (hex_para_bytes(hex, n, dados) >= 0) r = dec(dados, n / 2, ctx, saida);
+    free(dados);
+    return r;
+}
+
+static char *lz77_codec_codificar(sequencia *seq) { return hex_de_bruto(lz77_bruto, seq); }
+
+static size_t rlea_estimar(sequencia *seq) {
+    return 2 * rlea_comprimir(seq->conteudo, (size_t)seq->tamanho, NULL);
+}
+
+static uint8_t *rlea_bruto(sequencia *seq, size_t *n) {
+    uint8_t *buf = (uint8_t*)alocar(RLEA_CAP((size_t)seq->tamanho));
+    *n = rlea_comprimir(seq->conteudo, (size_t)seq->tamanho, buf);
+    return buf;
+}
+
+static long rlea_decodificar_bruto(const uint8_t *in, size_t n, const ctx_decod *ctx, uint8_t **saida) {
+    (void)ctx;
+    *saida = NULL;
+    long r = rlea_descomprimir(in, n, NULL);
+    if (r >= 0) {
+        *saida = (uint8_t*)alocar((size_t)r + 1);
+        rlea_descomprimir(in, n, *saida);
+    }
+    return r;
+}
+
+static char *rlea_codec_codificar(sequencia *seq) { return hex_de_bruto(rlea_bruto, seq); }
+
+static long rlea_codec_decodificar(const char *hex, size_t n, const ctx_decod *ctx, uint8_t **saida) {
+    return bruto_de_hex(rlea_decodificar_bruto, hex, n, ctx, saida);
+}
+
+static long lz77_codec_decodificar(const char *hex, size_t n, const ctx_decod *ctx, uint8_t **saida) {
+    return bruto_de_hex(lz77_decodificar_bruto, hex, n, ctx, saida);
+}
+
+static char *rc_codec_codificar(sequencia *seq) { return hex_de_bruto(rc_bruto, seq); }
+
+static long rc_codec_decodificar(const char *hex, size_t n, const ctx_decod *ctx, uint8_t **saida) {
+    return bruto_de_hex(rc_decodificar_bruto, hex, n, ctx, saida);
+}
+
+/* Ordem = ordem de impressão no empate. HUF e RLE formam o conjunto padrão (-C muda). */
+static const codec CODECS[NUM_CODECS] = {
+    { "HUF",  huf_preparar, huf_estimar,  huf_codec_codificar,  huf_codec_decodificar,  huf_bruto,  huf_decodificar_bruto },
+    { "RLE",  NULL,         rle_estimar,  rle_codec_codificar,  rle_codec_decodificar,  rle_bruto,  rle_decodificar_bruto },
+    { "LZ77", NULL,         NULL,         lz77_codec_codificar, lz77_codec_decodificar, lz77_bruto, lz77_decodificar_bruto },
+    { "RC",   NULL,         NULL,         rc_codec_codificar,   rc_codec_decodificar,   rc_bruto,   rc_decodificar_bruto },
+    { "RLEA", NULL,         rlea_estimar, rlea_codec_codificar, rlea_codec_decodificar, rlea_bruto, rlea_decodificar_bruto },
+};
+
+static int codec_por_nome(const char *nome, size_t n) {
+    for (int k = 0; k < NUM_CODECS; k++)
+        if (strlen(CODECS[k].nome) == n && strncasecmp(CODECS[k].nome, nome, n) == 0) return k;
+    return -1;
+}
+
+/* "-C huf,rle,lz77,rc,rlea" ou "-C todos". Devolve a máscara de codecs ou 0 se inválida. */
+static unsigned ler_lista_codecs(const char *s) {
+    if (strcmp(s, "todos") == 0) return (1u << NUM_CODECS) - 1;
+    unsigned m = 0;
+    while (*s) {
+        size_t n = strcspn(s, ",");
+        int k = codec_por_nome(s, n);
+        if (k < 0) {
+            fprintf(stderr, "Erro: codec desconhecido '%.*s' em -C (validos:", (int)n, s);
+            for (int j = 0; j < NUM_CODECS; j++) fprintf(stderr, " %s", CODECS[j].nome);
+            fprintf(stderr, " ou todos)\n");
+            return 0;
+        }
+        m |= 1u << k;
+        s += n;
+        if (*s == ',') s++;
+    }
+    if (!m) fprintf(stderr, "Erro: -C sem nenhum codec\n");
+    return m;
+}
+
+/* Lê a linha CAN ("t" e grupos SSLL) para uma tabela de códigos canônicos. */
+static long ler_linha_can(char *can_arg, const char *can, size_t n_can, tabela_huf *tab) {
+    char *q = can_arg;
+    long t = parse_int(&q);
+    memset(tab, 0, sizeof(*tab));
+    if (n_can % 4) return -1;
+    for (size_t k = 0; k < n_can; k += 4) {
+        uint8_t par[2];
+        if (hex_para_bytes(can + k, 4, par) < 0 || par[1] == 0 || par[1] > 64) return -1;
+        tab->len[par[0]] = par[1];
+    }
+    codigos_canonicos(tab->len, tab->cod);
+    return t;
+}
+
+/* --verify: decodifica cada payload gerado e compara com os bytes de entrada. */
+static int verificar_sequencia(const sequencia *seq, decodificador_huf *d) {
+    SONDA_INICIO(t0);
+    size_t t = (size_t)seq->tamanho;
+    ctx_decod ctx = { &seq->tab, t, d };
+    int r = 0;
+    for (int k = 0; k < NUM_CODECS; k++) {
+        const char *hex = seq->comprimido[k];
+        if (!hex) continue;
+        uint8_t *dec = NULL;
+        if (CODECS[k].decodificar(hex, strlen(hex), &ctx, &dec) != (long)t || memcmp(seq->conteudo, dec, t) != 0)
+            r = -1;
+        free(dec);
+    }
+    if (seq->bruto) {
+        uint8_t *dec = NULL;
+        if (CODECS[seq->codec_bin].decodificar_bruto(seq->bruto, seq->n_bruto, &ctx, &dec) != (long)t ||
+            memcmp(seq->conteudo, dec, t) != 0)
+            r = -1;
+        free(dec);
+    }
+    SONDA_FIM(ns_fase[ST_VERIFICACAO], t0);
+    return r;
+}
+
+/* ---------- Contêiner binário (-b) ----------
+ * Inteiros little-endian. Cabeçalho: "PAAB", versão (1 byte), 3 bytes zero.
+ * Registro por sequência: codec (1), zero (1), nº de símbolos HUF (2), tamanho original (4),
+ * bits do payload (8); para HUF, pares (símbolo, comprimento canônico); payload bruto com
+ * (bits + 7) / 8 bytes. Rodapé: deslocamento de cada registro (8 cada), deslocamento do
+ * índice (8), nº de registros (4) e "PAAI". */
+
+#define BIN_VERSAO 1
+#define BIN_CAB 8
+#define BIN_REG 16
+#define BIN_RODAPE 16
+#define ESCRITA_BIN_SZ (1u << 20)   /* write() sempre de blocos inteiros, alinhados no arquivo */
+
+static void le_escrever(uint8_t *p, uint64_t v, int n) {
+    for (int k = 0; k < n; k++) p[k] = (uint8_t)(v >> (8 * k));
+}
+
+static uint64_t le_ler(const uint8_t *p, int n) {
+    uint64_t v = 0;
+    for (int k = n - 1; k >= 0; k--) v = (v << 8) | p[k];
+    return v;
+}
+
+typedef struct escritor_bin {
+    int fd;
+    uint8_t *buf;             /* ESCRITA_BIN_SZ bytes alinhados a página */
+    size_t pos;
+    uint64_t total;           /* bytes já passados ao escritor (deslocamento atual) */
+    uint64_t *indice;
+    size_t n_indice, cap_indice;
+    int erro;
+} escritor_bin;
+
+static escritor_bin SAIDA_BIN;   /* só a thread escritora usa */
+
+static void bin_descarregar(escritor_bin *w) {
+    for (size_t feito = 0; feito < w->pos && !w->erro; ) {
+        ssize_t r = write(w->fd, w->buf + feito, w->pos - feito);
+        if (r <= 0) w->erro = 1;
+        else feito += (size_t)r;
+    }
+    w->pos = 0;
+}
+
+static void bin_escrever(escritor_bin *w, const void *dados, size_t n) {
+    const uint8_t *d = (const uint8_t*)dados;
+    w->total += n;
+    while (n > 0) {
+        size_t k = ESCRITA_BIN_SZ - w->pos < n ? ESCRITA_BIN_SZ - w->pos : n;
+        memcpy(w->buf + w->pos, d, k);
+        w->pos += k;
+        d += k;
+        n -= k;
+        if (w->pos == ESCRITA_BIN_SZ) bin_descarregar(w);
+    }
+}
+
+static int bin_abrir(escritor_bin *w, const char *nome) {
+    memset(w, 0, sizeof(*w));
+    w->fd = open(nome, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (w->fd < 0) return -1;
+    if (posix_memalign((void**)&w->buf, 4096, ESCRITA_BIN_SZ) != 0) { close(w->fd); return -1; }
+    uint8_t cab[BIN_CAB] = { 'P', 'A', 'A', 'B', BIN_VERSAO, 0, 0, 0 };
+    bin_escrever(w, cab, sizeof(cab));
+    return 0;
+}
+
+static void escrever_registro(escritor_bin *w, const sequencia *seq) {
+    if (w->n_indice == w->cap_indice) {
+        w->cap_indice = w->cap_indice ? 2 * w->cap_indice : 1024;
+        w->indice = (uint64_t*)realocar(w->indice, w->cap_indice * sizeof(uint64_t));
+    }
+    w->indice[w->n_indice++] = w->total;
+
+    uint8_t reg[BIN_REG + 512];
+    size_t n = BIN_REG;
+    int simbolos = 0;
+    uint64_t bits = (uint64_t)seq->n_bruto * 8;
+    if (seq->codec_bin == CODEC_HUF) {
+        for (int s = 0; s < 256; s++)
+            if (seq->tab.len[s]) { reg[n++] = (uint8_t)s; reg[n++] = seq->tab.len[s]; simbolos++; }
+        bits = seq->bits_huf;
+    }
+    reg[0] = (uint8_t)seq->codec_bin;
+    reg[1] = 0;
+    le_escrever(reg + 2, (uint64_t)simbolos, 2);
+    le_escrever(reg + 4, (uint64_t)seq->tamanho, 4);
+    le_escrever(reg + 8, bits, 8);
+    bin_escrever(w, reg, n);
+    bin_escrever(w, seq->bruto, (size_t)((bits + 7) / 8));
+}
+
+/* Grava o índice e o rodapé e fecha. Devolve -1 se alguma escrita falhou. */
+static int bin_fechar(escritor_bin *w) {
+    uint64_t inicio = w->total;
+    for (size_t i = 0; i < w->n_indice; i++) {
+        uint8_t d[8];
+        le_escrever(d, w->indice[i], 8);
+        bin_escrever(w, d, 8);
+    }
+    uint8_t rod[BIN_RODAPE] = { 0 };
+    le_escrever(rod, inicio, 8);
+    le_escrever(rod + 8, (uint64_t)w->n_indice, 4);
+    memcpy(rod + 12, "PAAI", 4);
+    bin_escrever(w, rod, sizeof(rod));
+    bin_descarregar(w);
+    if (close(w->fd) != 0) w->erro = 1;
+    free(w->buf);
+    free(w->indice);
+    return w->erro ? -1 : 0;
+}
+
+typedef struct registro_bin {
+    int codec;
+    size_t tamanho;
+    tabela_huf tab;
+    const uint8_t *payload;
+    size_t n_payload;
+} registro_bin;
+
+/* Índice do contêiner em b[0..n): devolve o nº de registros e *indice, ou -1 se inválido. */
+static long bin_indice(const uint8_t *b, size_t n, const uint8_t **indice) {
+    if (n < BIN_CAB + BIN_RODAPE || memcmp(b, "PAAB", 4) != 0 || b[4] != BIN_VERSAO ||
+        memcmp(b + n - 4, "PAAI", 4) != 0)
+        return -1;
+    uint64_t inicio = le_ler(b + n - BIN_RODAPE, 8), regs = le_ler(b + n - 8, 4);
+    if (inicio < BIN_CAB || inicio > n - BIN_RODAPE || (n - BIN_RODAPE - inicio) != regs * 8) return -1;
+    *indice = b + inicio;
+    return (long)regs;
+}
+
+/* Lê o registro i (limitado ao trecho antes do índice). */
+static int bin_registro(const uint8_t *b, const uint8_t *indice, long i, registro_bin *r) {
+    size_t fim = (size_t)(indice - b);
+    uint64_t off = le_ler(indice + 8 * i, 8);
+    if (off < BIN_CAB || off > fim || fim - off < BIN_REG) return -1;
+    const uint8_t *p = b + off;
+    size_t simbolos = (size_t)le_ler(p + 2, 2);
+    uint64_t bits = le_ler(p + 8, 8);
+    r->codec = p[0];
+    r->tamanho = (size_t)le_ler(p + 4, 4);
+    if (r->codec >= NUM_CODECS || simbolos > 256 || (simbolos && r->codec != CODEC_HUF)) return -1;
+    p += BIN_REG;
+    if ((size_t)(b + fim - p) < 2 * simbolos) return -1;
+    memset(&r->tab, 0, sizeof(r->tab));
+    for (size_t k = 0; k < simbolos; k++, p += 2) {
+        if (p[1] == 0 || p[1] > 64) return -1;
+        r->tab.len[p[0]] = p[1];
+    }
+    codigos_canonicos(r->tab.len, r->tab.cod);
+    r->payload = p;
+    r->n_payload = (size_t)((bits + 7) / 8);
+    if (bits > (uint64_t)(b + fim - p) * 8) return -1;
+    return 0;
+}
+
+static long bin_decodificar(const registro_bin *r, decodificador_huf *d, uint8_t **saida) {
+    ctx_decod ctx = { &r->tab, r->tamanho, d };
+    long t = CODECS[r->codec].decodificar_bruto(r->payload, r->n_payload, &ctx, saida);
+    return t == (long)r->tamanho ? t : -1;
+}
+
+/* -d sobre um contêiner: percorre o índice e escreve a entrada original. */
+static int descomprimir_binario(const uint8_t *b, size_t n, FILE *output) {
+    const uint8_t *indice;
+    long regs = bin_indice(b, n, &indice);
+    if (regs < 0) { fprintf(stderr, "Conteiner binario invalido\n"); return 1; }
+    fprintf(output, "%ld\n", regs);
+    decodificador_huf *d = (decodificador_huf*)alocar(sizeof(decodificador_huf));
+    int erro = 0;
+    for (long i = 0; i < regs && !erro; i++) {
+        registro_bin r;
+        uint8_t *bytes = NULL;
+        long t = bin_registro(b, indice, i, &r) == 0 ? bin_decodificar(&r, d, &bytes) : -1;
+        if (t < 0) {
+            fprintf(stderr, "Sequencia %ld: nao foi possivel decodificar\n", i);
+            erro = 1;
+        } else {
+            escrever_sequencia(output, bytes, (size_t)t);
+        }
+        free(bytes);
+    }
+    free(d);
+    return erro;
+}
+
+/* --extract N[,M..]: mapeia o contêiner, lê o índice e decodifica só as sequências pedidas
+ * (ranges "A-B" valem), escrevendo-as no formato de entrada na ordem da lista. */
+static int extrair_sequencias(const char *arq_entrada, const char *arq_saida, const char *lista) {
+    int fd = open(arq_entrada, O_RDONLY);
+    if (fd < 0) return 1;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) { close(fd); return 1; }
+    size_t n = (size_t)st.st_size;
+    const uint8_t *b = (const uint8_t*)mmap(NULL, n, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (b == MAP_FAILED) return 1;
+    madvise((void*)b, n, MADV_RANDOM);
+
+    const uint8_t *indice;
+    long regs = bin_indice(b, n, &indice);
+    FILE *output = regs >= 0 ? fopen(arq_saida, "w") : NULL;
+    if (!output) {
+        if (regs < 0) fprintf(stderr, "Conteiner binario invalido (--extract exige a saida de -b)\n");
+        munmap((void*)b, n);
+        return 1;
+    }
+
+    /* Primeira passada só valida e conta; a segunda decodifica. */
+    int erro = 0;
+    long total = 0;
+    decodificador_huf *d = (decodificador_huf*)alocar(sizeof(decodificador_huf));
+    for (int passo = 0; passo < 2 && !erro; passo++) {
+        if (passo == 1) fprintf(output, "%ld\n", total);
+        for (const char *s = lista; *s && !erro; ) {
+            char *e;
+            long a = strtol(s, &e, 10), z = a;
+            if (e != s && *e == '-') { s = e + 1; z = strtol(s, &e, 10); }
+            if (e == s || a < 0 || z < a || z >= regs || (*e && *e != ',')) {
+                fprintf(stderr, "Lista invalida em \"%s\" (%ld sequencias)\n", s, regs);
+                erro = 1;
+                break;
+            }
+            s = *e ? e + 1 : e;
+            if (passo == 0) { total += z - a + 1; continue; }
+            for (long i = a; i <= z && !erro; i++) {
+                registro_bin r;
+                uint8_t *bytes = NULL;
+                long t = bin_registro(b, indice, i, &r) == 0 ? bin_decodificar(&r, d, &bytes) : -1;
+                if (t < 0) {
+                    fprintf(stderr, "Sequencia %ld: nao foi possivel decodificar\n", i);
+                    erro = 1;
+                } else {
+                    escrever_sequencia(output, bytes, (size_t)t);
+                }
+                free(bytes);
+            }
+        }
+    }
+    free(d);
+    munmap((void*)b, n);
+    if (fclose(output) != 0) erro = 1;
+    return erro;
+}
+
+/* Modo -d: lê a saída da ferramenta e escreve a entrada original ("N" e "t AA BB ..."). */
+static int descomprimir(const char *arq_entrada, const char *arq_saida) {
+    entrada ent;
+    if (abrir_entrada(arq_entrada, &ent) != 0) return 1;
+    char *buf = ent.dados;
+    size_t nread = ent.tam;
+
+    FILE *output = fopen(arq_saida, "w");
+    if (!output) { fechar_entrada(&ent); return 1; }
+    setvbuf(output, NULL, _IOFBF, 256 * 1024);
+
+    if (nread >= 4 && memcmp(buf, "PAAB", 4) == 0) {
+        int erro = descomprimir_binario((const uint8_t*)buf, nread, output);
+        fechar_entrada(&ent);
+        fclose(output);
+        return erro;
+    }
+
+    /* Nº de sequências = índice da última linha + 1. */
+    long fim = (long)nread;
+    while (fim > 0 && (buf[fim - 1] == '\n' || buf[fim - 1] == '\r')) fim--;
+    long ini = fim;
+    while (ini > 0 && buf[ini - 1] != '\n') ini--;
+    char *q = buf + ini;
+    int quantidade = fim > 0 ? parse_int(&q) + 1 : 0;
+    fprintf(output, "%d\n", quantidade);
+
+    char *p = buf;
+    int erro = 0;
+    decodificador_huf *d = (decodificador_huf*)alocar(sizeof(decodificador_huf));
+    for (int i = 0; i < quantidade && !erro; i++) {
+        char *payload[NUM_CODECS] = {0}, *can = NULL, *can_arg = NULL;
+        size_t n_payload[NUM_CODECS] = {0}, n_can = 0;
+        while (*p) {
+            char *r = p;
+            int idx;
+            char tipo[8], *arg, *pl;
+            size_t n;
+            r = ler_linha_saida(r, &idx, tipo, &arg, &pl, &n);
+            if (!r) { erro = 1; break; }
+            if (idx != i) break;
+            int k = codec_por_nome(tipo, strlen(tipo));
+            if (k >= 0) { payload[k] = pl; n_payload[k] = n; }
+            else if (strcmp(tipo, "CAN") == 0) { can = pl; n_can = n; can_arg = arg; }
+            p = r;
+        }
+        if (erro) break;
+
+        /* Qualquer payload presente serve; HUF só com a linha CAN (saída gerada com -L). */
+        tabela_huf tab;
+        ctx_decod ctx = { NULL, 0, d };
+        long t = -1;
+        uint8_t *bytes = NULL;
+        if (can) {
+            long tc = ler_linha_can(can_arg, can, n_can, &tab);
+            if (tc >= 0) { ctx.tab = &tab; ctx.t = (size_t)tc; }
+        }
+        for (int k = 0; k < NUM_CODECS && t < 0; k++) {
+            if (!payload[k] || (k == CODEC_HUF && !ctx.tab)) continue;
+            free(bytes);
+            bytes = NULL;
+            t = CODECS[k].decodificar(payload[k], n_payload[k], &ctx, &bytes);
+        }
+        if (t < 0) {
+            fprintf(stderr, "Sequencia %d: nao foi possivel decodificar%s\n", i,
+                    (payload[CODEC_HUF] && !can) ? " (HUF sem linha CAN; gere a saida com -L)" : "");
+            erro = 1;
+        } else {
+            escrever_sequencia(output, bytes, (size_t)t);
+        }
+        free(bytes);
+        liberar_consumido(&ent, p);
+    }
+    free(d);
+
+    fechar_entrada(&ent);
+    fclose(output);
+    return erro;
+}
+
+/* Lê os seq->tamanho tokens a partir de *p direto para um vetor de bytes (1 byte por token).
+ * limite: fim dos bytes legíveis do buffer de entrada. */
+static int ler_sequencia(char **p, const char *limite, sequencia *seq) {
+    SONDA_INICIO(t0);
+    seq->conteudo = (uint8_t*)alocar((size_t)seq->tamanho + 1);
+    if (!seq->conteudo) return -1;
+    ler_tokens(p, limite, seq->conteudo, (size_t)seq->tamanho);
+    SONDA_FIM(ns_fase[ST_PARSE], t0);
+    return 0;
+}
+
+/* Avança *p sobre t tokens sem copiá-los (usado pelo parser do modo -j). */
+static void pular_tokens(char **p, int t) {
+    char *s = *p;
+    for (int j = 0; j < t; j++) {
+        while (*s == ' ' || *s == '\t' || *s == '\n' || *s == '\r') s++;
+        s += 2;
+    }
+    *p = s;
+}
+
+/* k está entre os menores percentuais dos codecs ativos? (comparações como no gabarito) */
+static int vencedor(const sequencia *seq, int k) {
+    for (int j = 0; j < NUM_CODECS; j++)
+        if ((OPC.codecs & (1u << j)) && seq->percentual[j] < seq->percentual[k]) return 0;
+    return 1;
+}
+
+#if INSTRUMENTAR
+/* log2 sem libm: expoente direto dos bits do double e série de atanh na mantissa. */
+static double log2_st(double x) {
+    uint64_t b;
+    memcpy(&b, &x, sizeof(b));
+    int e = (int)((b >> 52) & 0x7FF) - 1023;
+    b = (b & 0xFFFFFFFFFFFFFull) | 0x3FF0000000000000ull;
+    double m;
+    memcpy(&m, &b, sizeof(m));
+    if (m > 1.4142135623730951) { m /= 2; e++; }
+    double z = (m - 1) / (m + 1), z2 = z * z, p = z, soma = 0;
+    for (int k = 1; k < 32; k += 2) { soma += p / k; p *= z2; }
+    return e + 2 * soma * 1.4426950408889634;
+}
+
+/* Vencedores (todos no texto, o do registro no -b) e entropia de ordem 0 da sequência. */
+static void st_sequencia(const sequencia *seq) {
+    int venc = 0;
+    for (int k = 0; k < NUM_CODECS; k++) {
+        int v = OPC.binario ? seq->codec_bin == k : (OPC.codecs & (1u << k)) && vencedor(seq, k);
+        if (v) { ST.vitorias[k]++; venc++; }
+    }
+    if (venc > 1) ST.empates++;
+    ST.sequencias++;
+    size_t t = (size_t)seq->tamanho;
+    ST.bytes += t;
+    if (t == 0) return;
+    int H[256];
+    histograma_bytes(seq->conteudo, t, H);
+    double soma = 0;
+    for (int s = 0; s < 256; s++)
+        if (H[s]) soma += (double)H[s] * log2_st((double)H[s]);
+    double h = log2_st((double)t) - soma / (double)t;
+    if (h < 0) h = 0;
+    ST.entropia += h * (double)t;
+    if (ST.medidas++ == 0 || h < ST.entropia_min) ST.entropia_min = h;
+    if (h > ST.entropia_max) ST.entropia_max = h;
+    ST.faixa_entropia[h >= 8 ? 7 : (int)h]++;
+}
+
+/* Soma o ST da thread em ST_TOTAL (na saída de cada worker e no fim de main). */
+static void st_acumular(void) {
+    pthread_mutex_lock(&ST_MTX);
+    uint64_t *d = (uint64_t*)&ST_TOTAL, *o = (uint64_t*)&ST;
+    int vazio = ST_TOTAL.medidas == 0;
+    for (size_t k = 0; k < offsetof(contadores, entropia) / sizeof(uint64_t); k++) d[k] += o[k];
+    if (ST.medidas) {
+        if (vazio || ST.entropia_min < ST_TOTAL.entropia_min) ST_TOTAL.entropia_min = ST.entropia_min;
+        if (ST.entropia_max > ST_TOTAL.entropia_max) ST_TOTAL.entropia_max = ST.entropia_max;
+    }
+    ST_TOTAL.entropia += ST.entropia;
+    for (int k = 0; k < 8; k++) ST_TOTAL.faixa_entropia[k] += ST.faixa_entropia[k];
+    memset(&ST, 0, sizeof(ST));
+    pthread_mutex_unlock(&ST_MTX);
+}
+
+static void imprimir_estatisticas(void) {
+    static const char *fases[NUM_FASES_ST] = { "parse", "histograma", "arvore", "escrita", "verificacao" };
+    const contadores *c = &ST_TOTAL;
+    double b = c->bytes ? (double)c->bytes : 1;
+    printf("Estatisticas: %llu sequencias, %llu bytes (tempos somados entre threads)\n",
+           (unsigned long long)c->sequencias, (unsigned long long)c->bytes);
+    for (int f = 0; f < NUM_FASES_ST; f++)
+        printf("  %-12s %10.3f ms %8.3f ns/byte\n", fases[f], c->ns_fase[f] / 1e6, c->ns_fase[f] / b);
+    printf("  %-6s %12s %12s %8s %10s %8s %10s\n", "codec", "entrada", "saida", "razao", "ms", "ns/byte", "vitorias");
+    for (int k = 0; k < NUM_CODECS; k++) {
+        if (!(OPC.codecs & (1u << k))) continue;
+        printf("  %-6s %12llu %12llu %8.4f %10.3f %8.3f %10llu\n", CODECS[k].nome,
+               (unsigned long long)c->entrada[k], (unsigned long long)c->saida[k],
+               c->entrada[k] ? (double)c->saida[k] / (double)c->entrada[k] : 0.0,
+               c->ns_codec[k] / 1e6, c->ns_codec[k] / b, (unsigned long long)c->vitorias[k]);
+    }
+    printf("  (tempo do HUF inclui histograma e arvore) empates: %llu\n", (unsigned long long)c->empates);
+    printf("  entropia (bits/byte): media %.3f, min %.3f, max %.3f; sequencias por faixa:",
+           c->entropia / b, c->entropia_min, c->entropia_max);
+    for (int k = 0; k < 8; k++) printf(" [%d,%d) %llu", k, k + 1, (unsigned long long)c->faixa_entropia[k]);
+    printf("\n");
+    printf("  alocacoes no heap: %lu\n", ALOCACOES);
+}
+#endif
+
+/* -b: mesmo critério de escolha, sobre o tamanho em bytes; só o primeiro vencedor (ordem
+ * de CODECS) vai para seq->bruto. Codecs sem estimar geram o binário para medir. */
+static void comprimir_binario(sequencia *seq) {
+    uint8_t *buf[NUM_CODECS] = { 0 };
+    size_t n[NUM_CODECS] = { 0 };
+    for (int k = 0; k < NUM_CODECS; k++) {
+        seq->comprimido[k] = NULL;
+        if (!(OPC.codecs & (1u << k))) continue;
+        const codec *c = &CODECS[k];
+        SONDA_INICIO(t0);
+        if (c->preparar) c->preparar(seq);
+        if (c->estimar) n[k] = c->estimar(seq) / 2;
+        else buf[k] = c->bruto(seq, &n[k]);
+        SONDA_FIM(ns_codec[k], t0);
+        SONDA(ST.entrada[k] += (uint64_t)seq->tamanho; ST.saida[k] += n[k]);
+        seq->percentual[k] = (float)n[k] * 100.f / (float)seq->tamanho;
+    }
+    seq->codec_bin = -1;
+    for (int k = 0; k < NUM_CODECS; k++) {
+        if (seq->codec_bin < 0 && (OPC.codecs & (1u << k)) && vencedor(seq, k)) {
+            SONDA_INICIO(t0);
+            seq->codec_bin = k;
+            seq->bruto = buf[k] ? buf[k] : CODECS[k].bruto(seq, &n[k]);
+            seq->n_bruto = n[k];
+            SONDA_FIM(ns_codec[k], t0);
+        } else {
+            free(buf[k]);
+        }
+    }
+}
+
+/* Percentual de cada codec ativo: tamanho do payload em hex sobre 2 * t. Sem -e todos
+ * são gerados; com -e quem tem estimar só é gerado se vencer (perdedores ficam NULL). */
+static void comprimir_sequencia(sequencia *seq) {
+    int den = 2 * seq->tamanho;
+    seq->bruto = NULL;
+    if (OPC.binario) {
+        comprimir_binario(seq);
+        SONDA(st_sequencia(seq));
+        return;
+    }
+    for (int k = 0; k < NUM_CODECS; k++) {
+        seq->comprimido[k] = NULL;
+        if (!(OPC.codecs & (1u << k))) continue;
+        const codec *c = &CODECS[k];
+        size_t len;
+        SONDA_INICIO(t0);
+        if (c->preparar) c->preparar(seq);
+        if (OPC.estimar && c->estimar) {
+            len = c->estimar(seq);
+        } else {
+            seq->comprimido[k] = c->codificar(seq);
+            len = strlen(seq->comprimido[k]);
+        }
+        SONDA_FIM(ns_codec[k], t0);
+        SONDA(ST.entrada[k] += (uint64_t)seq->tamanho; ST.saida[k] += len / 2);
+        seq->percentual[k] = (float)len * 100.f / (float)den;
+    }
+    for (int k = 0; k < NUM_CODECS && OPC.estimar; k++) {
+        if (!(OPC.codecs & (1u << k))) continue;
+        if (!vencedor(seq, k)) {
+            free(seq->comprimido[k]);
+            seq->comprimido[k] = NULL;
+        } else if (!seq->comprimido[k]) {
+            SONDA_INICIO(t0);
+            seq->comprimido[k] = CODECS[k].codificar(seq);
+            SONDA_FIM(ns_codec[k], t0);
+        }
+    }
+    SONDA(st_sequencia(seq));
+}
+
+static void escrever_linhas(saida_texto *output, int i, const sequencia *seq);
+
+static void escrever_resultado(saida_texto *output, int i, const sequencia *seq) {
+    SONDA_INICIO(t0);
+    escrever_linhas(output, i, seq);
+    SONDA_FIM(ns_fase[ST_ESCRITA], t0);
+}
+
+/* Imprime todos os codecs de menor percentual (mais de um no empate), na ordem de CODECS. */
+static void escrever_linhas(saida_texto *output, int i, const sequencia *seq) {
+    if (OPC.binario) { escrever_registro(&SAIDA_BIN, seq); return; }
+    /* Gabarito não tem newline após a última linha; imprimir \n antes de cada linha exceto a primeira. */
+    int primeira = (i == 0);
+    for (int k = 0; k < NUM_CODECS; k++) {
+        if (!(OPC.codecs & (1u << k)) || !vencedor(seq, k)) continue;
+        if (!primeira) st_char(output, '\n');
+        primeira = 0;
+        /* "i->NOME(xx.xx%)=payload" */
+        st_uint(output, (uint64_t)i);
+        st_escrever(output, "->", 2);
+        st_escrever(output, CODECS[k].nome, strlen(CODECS[k].nome));
+        st_char(output, '(');
+        st_percentual(output, seq->percentual[k]);
+        st_escrever(output, "%)=", 3);
+        st_escrever(output, seq->comprimido[k], strlen(seq->comprimido[k]));
+    }
+    if (OPC.emitir_comprimentos && (OPC.codecs & (1u << CODEC_HUF)) && vencedor(seq, CODEC_HUF))
+        escrever_comprimentos(output, i, seq->tamanho, seq->tab.len);
+}
+
+/* Fecha a saída de texto ou, com -b, grava índice e rodapé do contêiner. */
+static int fechar_saida(saida_texto *output) {
+    if (OPC.binario) return bin_fechar(&SAIDA_BIN);
+    int r = st_fechar(output);
+    return close(output->fd) != 0 ? -1 : r;
+}
+
+static void liberar_sequencia(sequencia *seq) {
+    free(seq->conteudo);
+    free(seq->bruto);
+    for (int k = 0; k < NUM_CODECS; k++) free(seq->comprimido[k]);
+}
+
+/* ---------- Modo -j: parser -> workers -> escritor com buffer de reordenação ---------- */
+
+typedef struct tarefa {
+    char *inicio;      /* primeiro token da sequência no buffer de entrada */
+    char *fim;         /* logo após o último token */
+    sequencia seq;
+    int erro;          /* falha de alocação ao ler os tokens */
+    int falhou;        /* --verify não confirmou o round-trip */
+    int pronta;
+} tarefa;
+
+/* Janela circular de W tarefas: a tarefa i ocupa janela[i % W]. O parser só publica
+ * i quando i - escritas < W, o que limita a memória a W sequências em voo. */
+typedef struct pool_compressao {
+    pthread_mutex_t mtx;
+    pthread_cond_t cv_parser, cv_worker, cv_escritor;
+    tarefa *janela;
+    int W;
+    int total;
+    int lidas;       /* tarefas publicadas pelo parser */
+    int pegas;       /* tarefas retiradas pelos workers */
+    int escritas;    /* tarefas emitidas pelo escritor */
+    char *p;         /* cursor do parser */
+} pool_compressao;
+
+static void *thread_parser(void *arg) {
+    pool_compressao *pl = (pool_compressao*)arg;
+    for (int i = 0; i < pl->total; i++) {
+        pthread_mutex_lock(&pl->mtx);
+        while (i - pl->escritas >= pl->W) pthread_cond_wait(&pl->cv_parser, &pl->mtx);
+        pthread_mutex_unlock(&pl->mtx);
+
+        tarefa *tf = &pl->janela[i % pl->W];
+        tf->seq.tamanho = parse_int(&pl->p);
+        tf->inicio = pl->p;
+        pular_tokens(&pl->p, tf->seq.tamanho);
+        tf->fim = pl->p;
+
+        pthread_mutex_lock(&pl->mtx);
+        pl->lidas++;
+        pthread_cond_signal(&pl->cv_worker);
+        pthread_mutex_unlock(&pl->mtx);
+    }
+    return NULL;
+}
+
+static void *thread_worker(void *arg) {
+    pool_compressao *pl = (pool_compressao*)arg;
+    decodificador_huf *dec = OPC.verificar ? (decodificador_huf*)alocar(sizeof(decodificador_huf)) : NULL;
+    for (;;) {
+        pthread_mutex_lock(&pl->mtx);
+        while (pl->pegas == pl->lidas && pl->pegas < pl->total) pthread_cond_wait(&pl->cv_worker, &pl->mtx);
+        if (pl->pegas >= pl->total) { pthread_mutex_unlock(&pl->mtx); break; }
+        int i = pl->pegas++;
+        if (pl->pegas == pl->total) pthread_cond_broadcast(&pl->cv_worker);  /* acorda os demais para sair */
+        pthread_mutex_unlock(&pl->mtx);
+
+        tarefa *tf = &pl->janela[i % pl->W];
+        char *q = tf->inicio;
+        tf->erro = ler_sequencia(&q, tf->fim + 1, &tf->seq) != 0;
+        tf->falhou = 0;
+        if (!tf->erro) {
+            comprimir_sequencia(&tf->seq);
+            if (OPC.verificar && verificar_sequencia(&tf->seq, dec) != 0) tf->falhou = 1;
+        }
+
+        pthread_mutex_lock(&pl->mtx);
+        tf->pronta = 1;
+        pthread_cond_signal(&pl->cv_escritor);
+        pthread_mutex_unlock(&pl->mtx);
+    }
+    free(dec);
+    arena_destruir(&ARENA_HUF);
+    SONDA(st_acumular());
+    return NULL;
+}
+
+/* Comprime as sequências a partir de p com OPC.threads workers e escreve em ordem.
+ * Devolve o número de falhas do --verify, ou -1 se faltou memória. */
+static int comprimir_paralelo(entrada *ent, char *p, int total, saida_texto *output) {
+    pool_compressao pl;
+    memset(&pl, 0, sizeof(pl));
+    pthread_mutex_init(&pl.mtx, NULL);
+    pthread_cond_init(&pl.cv_parser, NULL);
+    pthread_cond_init(&pl.cv_worker, NULL);
+    pthread_cond_init(&pl.cv_escritor, NULL);
+    pl.W = OPC.janela;
+    pl.janela = (tarefa*)alocar_zerado((size_t)pl.W, sizeof(tarefa));
+    pl.total = total;
+    pl.p = p;
+
+    pthread_t parser;
+    pthread_t *workers = (pthread_t*)alocar((size_t)OPC.threads * sizeof(pthread_t));
+    pthread_create(&parser, NULL, thread_parser, &pl);
+    for (int k = 0; k < OPC.threads; k++) pthread_create(&workers[k], NULL, thread_worker, &pl);
+
+    int falhas = 0, erro = 0;
+    for (int i = 0; i < total; i++) {
+        tarefa *tf = &pl.janela[i % pl.W];
+        pthread_mutex_lock(&pl.mtx);
+        while (!tf->pronta) pthread_cond_wait(&pl.cv_escritor, &pl.mtx);
+        pthread_mutex_unlock(&pl.mtx);
+
+        if (tf->erro) {
+            erro = 1;
+        } else {
+            if (tf->falhou) {
+                fprintf(stderr, "Verificacao falhou na sequencia %d\n", i);
+                falhas++;
+            }
+            if (!erro) escrever_resultado(output, i, &tf->seq);
+            liberar_sequencia(&tf->seq);
+        }
+        liberar_consumido(ent, tf->fim);
+
+        pthread_mutex_lock(&pl.mtx);
+        tf->pronta = 0;
+        pl.escritas++;
+        pthread_cond_signal(&pl.cv_parser);
+        pthread_mutex_unlock(&pl.mtx);
+    }
+
+    pthread_join(parser, NULL);
+    for (int k = 0; k < OPC.threads; k++) pthread_join(workers[k], NULL);
+    free(workers);
+    free(pl.janela);
+    pthread_mutex_destroy(&pl.mtx);
+    pthread_cond_destroy(&pl.cv_parser);
+    pthread_cond_destroy(&pl.cv_worker);
+    pthread_cond_destroy(&pl.cv_escritor);
+    return erro ? -1 : falhas;
+}
+
+/* ---------- --bench: micro-benchmarks dos kernels ---------- */
+
+static double agora_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+/* Gerador xorshift para dados sintéticos reprodutíveis. */
+static uint64_t xorshift64(uint64_t *st) {
+    uint64_t x = *st;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    return *st = x;
+}
+
+static size_t contar_corridas(fn_fim_corrida f, const uint8_t *b, size_t t) {
+    size_t n = 0;
+    for (size_t i = 0; i < t; i = f(b, i, t)) n++;
+    return n;
+}
+
+static void bench_kernel(const char *nome, const char *dados, double seg, double base, size_t t) {
+    printf("%-12s %-18s %9.1f MB/s  %5.2fx\n", dados, nome, (double)t / seg / 1e6, base / seg);
+}
+
+/* Custo (bits totais) da árvore para o histograma H. */
+static uint64_t custo_arvore(no *raiz, const int H[256]) {
+    uint64_t cod[256];
+    uint8_t len[256] = { 0 };
+    tabela_codigos_iter(raiz, cod, len);
+    uint64_t bits = 0;
+    for (int s = 0; s < 256; s++) bits += (uint64_t)H[s] * len[s];
+    return bits;
+}
+
+/* Heap x duas filas sobre histogramas aleatórios (alfabeto cheio e esparso, frequências
+ * pequenas com muitos empates e grandes); o custo das duas árvores tem de ser igual. */
+static int bench_arvores(void) {
+    enum { NH = 4096, REPS = 20 };
+    int (*H)[256] = (int(*)[256])alocar(NH * sizeof(*H));
+    uint64_t st = 0x2545F4914F6CDD1Dull;
+    for (int h = 0; h < NH; h++) {
+        int usados = (h & 1) ? 256 : 2 + (int)(xorshift64(&st) % 64);
+        unsigned teto = (h & 2) ? 1000000u : 16u;
+        memset(H[h], 0, sizeof(H[h]));
+        for (int j = 0; j < usados; j++) H[h][xorshift64(&st) & 0xFF] = 1 + (int)(xorshift64(&st) % teto);
+    }
+    for (int h = 0; h < NH; h++)
+        if (custo_arvore(construir_arvore_heap(H[h], 256), H[h]) != custo_arvore(construir_arvore_duas_filas(H[h], 256), H[h])) {
+            fprintf(stderr, "arvore duas filas divergiu do heap no histograma %d\n", h);
+            free(H);
+            return 1;
+        }
+    struct { const char *nome; no *(*f)(int[], int); } c[2] = {
+        { "arvore heap", construir_arvore_heap }, { "arvore 2 filas", construir_arvore_duas_filas } };
+    double base = 0;
+    for (int j = 0; j < 2; j++) {
+        double t0 = agora_s();
+        for (int r = 0; r < REPS; r++)
+            for (int h = 0; h < NH; h++) c[j].f(H[h], 256);
+        double seg = (agora_s() - t0) / REPS;
+        if (j == 0) base = seg;
+        printf("%-12s %-18s %9.1f K arv/s  %5.2fx\n", "histogramas", c[j].nome, NH / seg / 1e3, base / seg);
+    }
+    free(H);
+    return 0;
+}
+
+/* HUF (histograma + tabela canônica + fluxo) de uma sequência de 64 MB com 1, 2, 4, ...
+ * threads por sequência, até o nº de CPUs; o fluxo tem de ser igual ao serial. */
+static int bench_huf_paralelo(void) {
+    const size_t t = 64u << 20;
+    uint8_t *b = (uint8_t*)alocar(t), *ref = (uint8_t*)alocar(t + 16), *buf = (uint8_t*)alocar(t + 16);
+    uint64_t st = 0x5851F42D4C957F2Dull;
+    for (size_t i = 0; i < t; i++) {
+        uint64_t x = xorshift64(&st);
+        b[i] = (uint8_t)((x & 0xFF) < ((x >> 8) & 0xFF) ? x : x >> 8);  /* menor de dois: enviesado */
+    }
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    opcoes salvas = OPC;
+    OPC.canonico = 1;
+    tabela_huf tab;
+    size_t n_ref = 0;
+    double base = 0;
+    /* Ao menos até 4, para conferir a costura mesmo em máquinas pequenas. */
+    for (int n = 1; n <= MAX_THREADS_SEQ && n <= (cpus > 4 ? cpus : 4); n *= 2) {
+        OPC.threads_seq = n;
+        double t0 = agora_s();
+        huf_tabela(b, t, &tab);
+        size_t nb = huf_bits(b, t, &tab, n == 1 ? ref : buf);
+        double seg = agora_s() - t0;
+        if (n == 1) { base = seg; n_ref = nb; }
+        else if (nb != n_ref || memcmp(buf, ref, nb) != 0) {
+            fprintf(stderr, "huf com %d threads divergiu do serial\n", n);
+            OPC = salvas;
+            free(b); free(ref); free(buf);
+            return 1;
+        }
+        char nome[32];
+        snprintf(nome, sizeof(nome), "huf -p %d", n);
+        bench_kernel(nome, "enviesado", seg, base, t);
+    }
+    OPC = salvas;
+    free(b);
+    free(ref);
+    free(buf);
+    return 0;
+}
+
+/* Compara histograma ingênuo x 4 sub-histogramas e corridas escalar x SSE2 x AVX2
+ * em dados de corridas longas e de alta entropia, e o parse/formatação hex escalar x SIMD. */
+static int executar_bench_kernels(void) {
+    const size_t t = 16u << 20;
+    const int reps = 5;
+    uint8_t *longas = (uint8_t*)alocar(t), *aleat = (uint8_t*)alocar(t);
+    uint64_t st = 0x9E3779B97F4A7C15ull;
+    for (size_t i = 0; i < t; ) {
+        uint8_t c = (uint8_t)xorshift64(&st);
+        size_t r = 64 + xorshift64(&st) % 1024;
+        for (; r > 0 && i < t; r--) longas[i++] = c;
+    }
+    for (size_t i = 0; i < t; i++) aleat[i] = (uint8_t)xorshift64(&st);
+
+    const uint8_t *conj[2] = { longas, aleat };
+    const char *nomes[2] = { "corridas", "aleatorio" };
+    int H[256];
+    for (int d = 0; d < 2; d++) {
+        double t0 = agora_s();
+        for (int r = 0; r < reps; r++) histograma_simples(conj[d], t, H);
+        double base = (agora_s() - t0) / reps;
+        bench_kernel("hist simples", nomes[d], base, base, t);
+        t0 = agora_s();
+        for (int r = 0; r < reps; r++) histograma_bytes(conj[d], t, H);
+        bench_kernel("hist 4 vias", nomes[d], (agora_s() - t0) / reps, base, t);
+
+        struct { const char *nome; fn_fim_corrida f; } k[3] = { { "corrida escalar", fim_corrida_escalar } };
+        int nk = 1;
+#ifdef TEM_X86_SIMD
+        k[nk].nome = "corrida sse2"; k[nk++].f = fim_corrida_sse2;
+        if (__builtin_cpu_supports("avx2")) { k[nk].nome = "corrida avx2"; k[nk++].f = fim_corrida_avx2; }
+#endif
+        size_t ref = 0;
+        for (int j = 0; j < nk; j++) {
+            t0 = agora_s();
+            size_t n = 0;
+            for (int r = 0; r < reps; r++) n = contar_corridas(k[j].f, conj[d], t);
+            double seg = (agora_s() - t0) / reps;
+            if (j == 0) { ref = n; base = seg; }
+            else if (n != ref) { fprintf(stderr, "%s divergiu do escalar\n", k[j].nome); return 1; }
+            bench_kernel(k[j].nome, nomes[d], seg, base, t);
+        }
+    }
+
+    /* E/S hex: texto "AA BB ..." -> bytes e bytes -> hex, sobre os dados aleatórios. */
+    char *texto = (char*)alocar(3 * t + 1), *hex = (char*)alocar(2 * t + 1);
+    formatar_hex_escalar(aleat, t, hex);
+    for (size_t i = 0; i < t; i++) {
+        texto[3 * i] = hex[2 * i];
+        texto[3 * i + 1] = hex[2 * i + 1];
+        texto[3 * i + 2] = ' ';
+    }
+    texto[3 * t] = '\0';
+    struct { const char *nome; fn_ler_tokens f; } lt[3] = { { "parse escalar", ler_tokens_escalar } };
+    struct { const char *nome; fn_formatar_hex f; } fh[3] = { { "hex escalar", formatar_hex_escalar } };
+    int nl = 1, nf = 1;
+#ifdef TEM_X86_SIMD
+    if (__builtin_cpu_supports("ssse3")) {
+        lt[nl].nome = "parse ssse3"; lt[nl++].f = ler_tokens_ssse3;
+        fh[nf].nome = "hex ssse3"; fh[nf++].f = formatar_hex_ssse3;
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        lt[nl].nome = "parse avx2"; lt[nl++].f = ler_tokens_avx2;
+        fh[nf].nome = "hex avx2"; fh[nf++].f = formatar_hex_avx2;
+    }
+#endif
+    double base = 0;
+    for (int j = 0; j < nl; j++) {
+        double t0 = agora_s();
+        for (int r = 0; r < reps; r++) {
+            char *q = texto;
+            lt[j].f(&q, texto + 3 * t + 1, longas, t);
+        }
+        double seg = (agora_s() - t0) / reps;
+        if (j == 0) base = seg;
+        if (memcmp(longas, aleat, t) != 0) { fprintf(stderr, "%s divergiu do escalar\n", lt[j].nome); return 1; }
+        bench_kernel(lt[j].nome, "tokens", seg, base, t);
+    }
+    for (int j = 0; j < nf; j++) {
+        double t0 = agora_s();
+        for (int r = 0; r < reps; r++) fh[j].f(aleat, t, texto);
+        double seg = (agora_s() - t0) / reps;
+        if (j == 0) base = seg;
+        if (memcmp(texto, hex, 2 * t) != 0) { fprintf(stderr, "%s divergiu do escalar\n", fh[j].nome); return 1; }
+        bench_kernel(fh[j].nome, "bytes", seg, base, t);
+    }
+    free(texto);
+    free(hex);
+    free(longas);
+    free(aleat);
+    return bench_arvores() || bench_huf_paralelo();
+}
+
+/* ---------- --bench-corpus: corpora sintéticos e tempo por fase do codificador ---------- */
+
+enum { CORPUS_UNIFORME, CORPUS_ZIPF, CORPUS_CORRIDAS, CORPUS_MISTO, NUM_CORPUS };
+static const char *NOMES_CORPUS[NUM_CORPUS] = { "uniforme", "zipf", "corridas", "misto" };
+
+/* Preenche b[0..t) com um dos geradores (misto sorteia um por sequência). cdf: Zipf s = 1. */
+static void gerar_dados(int tipo, uint8_t *b, size_t t, const uint32_t cdf[256], uint64_t *st) {
+    if (tipo == CORPUS_MISTO) tipo = (int)(xorshift64(st) % CORPUS_MISTO);
+    if (tipo == CORPUS_UNIFORME) {
+        for (size_t i = 0; i < t; i++) b[i] = (uint8_t)xorshift64(st);
+    } else if (tipo == CORPUS_ZIPF) {
+        for (size_t i = 0; i < t; i++) {
+            uint32_t u = (uint32_t)(xorshift64(st) % cdf[255]);
+            int lo = 0, hi = 255;
+            while (lo < hi) { int m = (lo + hi) / 2; if (cdf[m] > u) hi = m; else lo = m + 1; }
+            b[i] = (uint8_t)lo;
+        }
+    } else {
+        for (size_t i = 0; i < t; ) {
+            uint8_t c = (uint8_t)xorshift64(st);
+            for (size_t r = 64 + xorshift64(st) % 1024; r > 0 && i < t; r--) b[i++] = c;
+        }
+    }
+}
+
+/* Texto de entrada ("N" e linhas "t AA BB ...") com ~mb MB de dados em sequências de até 64 KB.
+ * Termina em '\0' com folga zerada para os parsers SIMD, como a entrada mapeada. */
+static char *gerar_corpus(int tipo, size_t mb, uint64_t *st, size_t *n_texto, int *n_seq, size_t *n_dados) {
+    uint32_t cdf[256];
+    double acc = 0;
+    for (int k = 0; k < 256; k++) { acc += 1.0 / (k + 1); cdf[k] = (uint32_t)(acc * 1e6); }
+
+    size_t alvo = mb << 20, cap = 3 * alvo + (alvo / 2) + 64;
+    char *texto = (char*)alocar_zerado(cap + 64, 1);
+    uint8_t *b = (uint8_t*)alocar(65536);
+    size_t pos = 0, dados = 0;
+    int n = 0;
+    pos += (size_t)sprintf(texto, "%-10d\n", 0);   /* reescrito no fim com o nº de sequências */
+    while (dados < alvo) {
+        size_t t = 1 + xorshift64(st) % 65536;
+        if (t > alvo - dados) t = alvo - dados;
+        gerar_dados(tipo, b, t, cdf, st);
+        pos += (size_t)sprintf(texto + pos, "%zu ", t);
+        for (size_t i = 0; i < t; i++) {
+            texto[pos++] = hex_table[b[i] >> 4];
+            texto[pos++] = hex_table[b[i] & 15];
+            texto[pos++] = i + 1 < t ? ' ' : '\n';
+        }
+        dados += t;
+        n++;
+    }
+    char cab[12];
+    snprintf(cab, sizeof(cab), "%-10d", n);
+    memcpy(texto, cab, 10);
+    texto[pos] = '\0';
+    free(b);
+    *n_texto = pos;
+    *n_seq = n;
+    *n_dados = dados;
+    return texto;
+}
+
+enum { FASE_PARSE, FASE_HISTOGRAMA, FASE_ARVORE, FASE_CODIFICAR, FASE_HEX, FASE_ESCRITA, NUM_FASES };
+static const char *NOMES_FASES[NUM_FASES] = { "parse", "histograma", "arvore", "codificar", "hex", "escrita" };
+
+typedef struct resultado_bench {
+    const char *corpus;
+    size_t mb, bytes_texto, bytes_dados;
+    int sequencias;
+    double seg, fase[NUM_FASES];
+    double seg_codec[NUM_CODECS];      /* preparar + bruto de cada codec, fora das fases */
+    uint64_t bytes_codec[NUM_CODECS];  /* payload binário de cada codec */
+    long alocacoes;           /* alocar/alocar_zerado/realocar do programa */
+    long pico_rss_kb;         /* pico do processo até aqui (ru_maxrss) */
+} resultado_bench;
+
+/* Caminho serial padrão (HUF + RLE) com as etapas de comprimir_sequencia separadas para
+ * cronometrar cada fase; a escrita vai para /dev/null (só formatação e stdio). Depois,
+ * fora das fases, cada codec de CODECS gera o payload binário para razão e vazão. */
+static void medir_corpus(char *texto, size_t n_texto, saida_texto *nulo, resultado_bench *r) {
+    unsigned long aloc0 = __atomic_load_n(&ALOCACOES, __ATOMIC_RELAXED);
+    char *p = texto;
+    const char *limite = texto + n_texto + 1;
+    int total = parse_int(&p);
+    double inicio = agora_s();
+    for (int i = 0; i < total; i++) {
+        sequencia seq;
+        int H[256];
+        double t[NUM_FASES + 1];
+        t[0] = agora_s();
+        seq.tamanho = parse_int(&p);
+        if (ler_sequencia(&p, limite, &seq) != 0) break;
+        size_t n = (size_t)seq.tamanho;
+        t[1] = agora_s();
+        histograma_bytes(seq.conteudo, n, H);
+        t[2] = agora_s();
+        memset(&seq.tab, 0, sizeof(seq.tab));
+        tabela_codigos_iter(construir_arvore(H, 256), seq.tab.cod, seq.tab.len);
+        seq.bits_huf = 0;
+        for (int s = 0; s < 256; s++) seq.bits_huf += (uint64_t)H[s] * seq.tab.len[s];
+        t[3] = agora_s();
+        uint8_t *bits = (uint8_t*)alocar((size_t)((seq.bits_huf + 7) / 8) + 1), *pares = (uint8_t*)alocar(2 * n);
+        size_t n_bits = huf_bits(seq.conteudo, n, &seq.tab, bits), n_pares = rle_pares(seq.conteudo, n, pares);
+        t[4] = agora_s();
+        for (int k = 0; k < NUM_CODECS; k++) seq.comprimido[k] = NULL;
+        seq.comprimido[CODEC_HUF] = bytes_to_hex(bits, n_bits);
+        seq.comprimido[CODEC_RLE] = bytes_to_hex(pares, n_pares);
+        free(bits);
+        free(pares);
+        t[5] = agora_s();
+        seq.percentual[CODEC_HUF] = (float)(2 * n_bits) * 100.f / (float)(2 * n);
+        seq.percentual[CODEC_RLE] = (float)(2 * n_pares) * 100.f / (float)(2 * n);
+        escrever_resultado(nulo, i, &seq);
+        t[6] = agora_s();
+        for (int f = 0; f < NUM_FASES; f++) r->fase[f] += t[f + 1] - t[f];
+        for (int k = 0; k < NUM_CODECS; k++) {
+            double c0 = agora_s();
+            if (CODECS[k].preparar) CODECS[k].preparar(&seq);
+            size_t nb;
+            free(CODECS[k].bruto(&seq, &nb));
+            r->seg_codec[k] += agora_s() - c0;
+            r->bytes_codec[k] += nb;
+        }
+        liberar_sequencia(&seq);
+    }
+    r->seg = agora_s() - inicio;
+    for (int k = 0; k < NUM_CODECS; k++) r->seg -= r->seg_codec[k];
+    r->alocacoes = (long)(__atomic_load_n(&ALOCACOES, __ATOMIC_RELAXED) - aloc0);
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    r->pico_rss_kb = ru.ru_maxrss;
+}
+
+static void escrever_bench(FILE *out, const resultado_bench *r, int n, int json) {
+    if (json) fputs("[\n", out);
+    else {
+        fputs("corpus,tamanho_mb,sequencias,bytes_texto,bytes_dados,segundos,mb_s", out);
+        for (int f = 0; f < NUM_FASES; f++) fprintf(out, ",ns_byte_%s", NOMES_FASES[f]);
+        for (int k = 0; k < NUM_CODECS; k++) fprintf(out, ",razao_%s,mb_s_%s", CODECS[k].nome, CODECS[k].nome);
+        fputs(",alocacoes,pico_rss_kb\n", out);
+    }
+    for (int i = 0; i < n; i++, r++) {
+        double mbs = (double)r->bytes_texto / r->seg / 1e6;
+        if (json) {
+            fprintf(out, "  {\"corpus\": \"%s\", \"tamanho_mb\": %zu, \"sequencias\": %d, \"bytes_texto\": %zu, "
+                    "\"bytes_dados\": %zu, \"segundos\": %.6f, \"mb_s\": %.2f, \"ns_byte\": {",
+                    r->corpus, r->mb, r->sequencias, r->bytes_texto, r->bytes_dados, r->seg, mbs);
+            for (int f = 0; f < NUM_FASES; f++)
+                fprintf(out, "%s\"%s\": %.3f", f ? ", " : "", NOMES_FASES[f], r->fase[f] * 1e9 / (double)r->bytes_dados);
+            fputs("}, \"codecs\": {", out);
+            for (int k = 0; k < NUM_CODECS; k++)
+                fprintf(out, "%s\"%s\": {\"razao\": %.4f, \"mb_s\": %.2f}", k ? ", " : "", CODECS[k].nome,
+                        (double)r->bytes_codec[k] / (double)r->bytes_dados, (double)r->bytes_dados / r->seg_codec[k] / 1e6);
+            fprintf(out, "}, \"alocacoes\": %ld, \"pico_rss_kb\": %ld}%s\n", r->alocacoes, r->pico_rss_kb, i + 1 < n ? "," : "");
+        } else {
+            fprintf(out, "%s,%zu,%d,%zu,%zu,%.6f,%.2f", r->corpus, r->mb, r->sequencias, r->bytes_texto, r->bytes_dados, r->seg, mbs);
+            for (int f = 0; f < NUM_FASES; f++) fprintf(out, ",%.3f", r->fase[f] * 1e9 / (double)r->bytes_dados);
+            for (int k = 0; k < NUM_CODECS; k++)
+                fprintf(out, ",%.4f,%.2f", (double)r->bytes_codec[k] / (double)r->bytes_dados, (double)r->bytes_dados / r->seg_codec[k] / 1e6);
+            fprintf(out, ",%ld,%ld\n", r->alocacoes, r->pico_rss_kb);
+        }
+    }
+    if (json) fputs("]\n", out);
+}
+
+/* --bench-corpus [-t MB,MB,...] [-o arquivo]: cada corpus em cada tamanho (padrão 4 MB).
+ * MB/s sobre o texto de entrada; ns/byte por fase, razão (bytes binários / dados) e MB/s de
+ * cada codec sobre os bytes de dados. Saída CSV, ou JSON quando o arquivo termina em .json;
+ * sem -o, CSV na saída padrão. */
+static int executar_bench_corpus(int argc, char *argv[]) {
+    size_t tamanhos[16] = { 4 };
+    int nt = 1;
+    const char *arq = NULL;
+    for (int a = 0; a < argc; a++) {
+        if (strcmp(argv[a], "-t") == 0 && a + 1 < argc) {
+            char *s = argv[++a];
+            for (nt = 0; *s && nt < 16; ) {
+                long v = strtol(s, &s, 10);
+                if (v <= 0) return 1;
+                tamanhos[nt++] = (size_t)v;
+                if (*s == ',') s++;
+                else if (*s) return 1;
+            }
+        } else if (strcmp(argv[a], "-o") == 0 && a + 1 < argc) arq = argv[++a];
+        else return 1;
+    }
+    size_t la = arq ? strlen(arq) : 0;
+    int json = la >= 5 && strcmp(arq + la - 5, ".json") == 0;
+
+    OPC.codecs = (1u << CODEC_HUF) | (1u << CODEC_RLE);
+    saida_texto nulo;
+    int fd_nulo = open("/dev/null", O_WRONLY);
+    if (fd_nulo < 0 || st_abrir(&nulo, fd_nulo) != 0) return 1;
+    resultado_bench *res = (resultado_bench*)alocar_zerado((size_t)(nt * NUM_CORPUS), sizeof(resultado_bench));
+    uint64_t st = 0x9E3779B97F4A7C15ull;
+    int n = 0;
+    for (int i = 0; i < nt; i++)
+        for (int c = 0; c < NUM_CORPUS; c++, n++) {
+            resultado_bench *r = &res[n];
+            char *texto = gerar_corpus(c, tamanhos[i], &st, &r->bytes_texto, &r->sequencias, &r->bytes_dados);
+            r->corpus = NOMES_CORPUS[c];
+            r->mb = tamanhos[i];
+            medir_corpus(texto, r->bytes_texto, &nulo, r);
+            free(texto);
+            fprintf(stderr, "%-9s %4zu MB  %8.1f MB/s\n", r->corpus, r->mb, (double)r->bytes_texto / r->seg / 1e6);
+        }
+    st_fechar(&nulo);
+    close(fd_nulo);
+    arena_destruir(&ARENA_HUF);
+
+    FILE *out = arq ? fopen(arq, "w") : stdout;
+    if (!out) { free(res); return 1; }
+    escrever_bench(out, res, n, json);
+    if (arq) fclose(out);
+    free(res);
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    clock_t inicio, fim;
+    double tempo_gasto;
+    inicio = clock();
+
+    init_hex_table();
+    init_kernels();
+    if (argc == 2 && strcmp(argv[1], "--bench") == 0) return executar_bench_kernels();
+    if (argc >= 2 && strcmp(argv[1], "--bench-corpus") == 0) return executar_bench_corpus(argc - 2, argv + 2);
+
+    const char *arq_entrada = NULL, *arq_saida = NULL;
+    for (int a = 1; a < argc; a++) {
+        if (strcmp(argv[a], "-c") == 0) OPC.canonico = 1;
+        else if (strcmp(argv[a], "-L") == 0) OPC.canonico = OPC.emitir_comprimentos = 1;
+        else if (strcmp(argv[a], "-d") == 0) OPC.descomprimir = 1;
+        else if (strcmp(argv[a], "-e") == 0) OPC.estimar = 1;
+        else if (strcmp(argv[a], "-H") == 0) OPC.arvore_duas_filas = 0;
+        else if (strcmp(argv[a], "-Q") == 0) OPC.arvore_duas_filas = 1;
+        else if (strcmp(argv[a], "-b") == 0) OPC.canonico = OPC.binario = 1;
+        else if (strcmp(argv[a], "-l") == 0 && a + 1 < argc) {
+            char *fim;
+            long l = strtol(argv[++a], &fim, 10);
+            if (*fim || fim == argv[a] || l < 1 || l > 64) {
+                fprintf(stderr, "Erro: -l espera um limite de 1 a 64 bits (recebido '%s')\n", argv[a]);
+                return 1;
+            }
+            OPC.limite = (int)l;
+            OPC.canonico = 1;
+        }
+        else if (strcmp(argv[a], "-C") == 0 && a + 1 < argc) {
+            OPC.codecs = ler_lista_codecs(argv[++a]);
+            if (!OPC.codecs) return 1;
+        }
+        else if (strcmp(argv[a], "--verify") == 0) OPC.verificar = 1;
+        else if (strcmp(argv[a], "--stats") == 0) OPC.estatisticas = 1;
+        else if (strcmp(argv[a], "--extract") == 0 && a + 1 < argc) OPC.extrair = argv[++a];
+        else if (strcmp(argv[a], "-j") == 0 && a + 1 < argc) OPC.threads = atoi(argv[++a]);
+        else if (strcmp(argv[a], "-p") == 0 && a + 1 < argc) {
+            OPC.threads_seq = atoi(argv[++a]);
+            if (OPC.threads_seq > MAX_THREADS_SEQ) OPC.threads_seq = MAX_THREADS_SEQ;
+        }
+        else if (strcmp(argv[a], "-w") == 0 && a + 1 < argc) OPC.janela = atoi(argv[++a]);
+        else if (!arq_entrada) arq_entrada = argv[a];
+        else if (!arq_saida) arq_saida = argv[a];
+        else {
+            fprintf(stderr, "Erro: argumento inesperado '%s'\n", argv[a]);
+            return 1;
+        }
+    }
+    if (!arq_entrada || !arq_saida) {
+        fprintf(stderr, "Erro: informe os arquivos de entrada e saida\n");
+        return 1;
+    }
+    if (!OPC.codecs) OPC.codecs = (1u << CODEC_HUF) | (1u << CODEC_RLE);
+    if (OPC.janela <= 0) OPC.janela = 4 * (OPC.threads > 1 ? OPC.threads : 1);
+    if (OPC.descomprimir) return descomprimir(arq_entrada, arq_saida);
+    if (OPC.extrair) return extrair_sequencias(arq_entrada, arq_saida, OPC.extrair);
+
+    entrada ent;
+    if (abrir_entrada(arq_entrada, &ent) != 0) return 1;
+    if (ent.tam == 0) { fechar_entrada(&ent); return 1; }
+
+    saida_texto saida, *output = &saida;
+    int fd_saida = OPC.binario ? -1 : open(arq_saida, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (OPC.binario ? bin_abrir(&SAIDA_BIN, arq_saida) != 0 : fd_saida < 0 || st_abrir(output, fd_saida) != 0) {
+        fechar_entrada(&ent);
+        return 1;
+    }
+
+    char *p = ent.dados;
+    int quantidade_sequencias = parse_int(&p);
+    int falhas = 0;
+
+    if (OPC.threads > 1) {
+        falhas = comprimir_paralelo(&ent, p, quantidade_sequencias, output);
+        if (falhas < 0) { fechar_entrada(&ent); fechar_saida(output); return 1; }
+    } else {
+        decodificador_huf *dec = OPC.verificar ? (decodificador_huf*)alocar(sizeof(decodificador_huf)) : NULL;
+        for (int i = 0; i < quantidade_sequencias; i++) {
+            sequencia Sequencia;
+            Sequencia.tamanho = parse_int(&p);
+            if (ler_sequencia(&p, ent.dados + ent.tam + 1, &Sequencia) != 0) { fechar_entrada(&ent); fechar_saida(output); return 1; }
+            comprimir_sequencia(&Sequencia);
+            escrever_resultado(output, i, &Sequencia);
+            if (OPC.verificar && verificar_sequencia(&Sequencia, dec) != 0) {
+                fprintf(stderr, "Verificacao falhou na sequencia %d\n", i);
+                falhas++;
+            }
+            liberar_sequencia(&Sequencia);
+            liberar_consumido(&ent, p);
+        }
+        free(dec);
+    }
+
+    fechar_entrada(&ent);
+    if (fechar_saida(output) != 0) return 1;
+    fim = clock();
+    tempo_gasto = (double)(fim - inicio) / CLOCKS_PER_SEC;
+    printf("Tempo de execucao: %f segundos\n", tempo_gasto);
+    printf("Saída escrita em: %s\n", arq_saida);
+    arena_destruir(&ARENA_HUF);
+    if (OPC.estatisticas)
+        printf("Alocacoes da arena da arvore: %lu (para %d sequencias)\n", ALOCACOES_ARENA, quantidade_sequencias);
+    SONDA(st_acumular(); imprimir_estatisticas());
+    if (!INSTRUMENTAR && OPC.estatisticas)
+        fprintf(stderr, "--stats: relatorio do pipeline ausente (build com -DINSTRUMENTAR=0)\n");
+    if (OPC.estatisticas && OPC.limite)
+        printf("Limite de %d bits: %llu bits contra %llu sem limite (+%.3f%%), %lu sequencias afetadas\n",
+               OPC.limite, (unsigned long long)BITS_LIMITADO, (unsigned long long)BITS_SEM_LIMITE,
+               BITS_SEM_LIMITE ? 100.0 * (double)(BITS_LIMITADO - BITS_SEM_LIMITE) / (double)BITS_SEM_LIMITE : 0.0,
+               SEQ_LIMITADAS);
+    if (OPC.verificar) {
+        printf("Verificacao: %d de %d sequencias com falha\n", falhas, quantidade_sequencias);
+        if (falhas) return 2;
+    }
     return 0;
 }
\ No newline at end of file
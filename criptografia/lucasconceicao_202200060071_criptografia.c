@@ -11,6 +11,7 @@
 #include <string.h>
 #include <stdint.h>
 #include <ctype.h>
+#include <time.h>
 
 /* ========== Definição dos dígitos (slide: estrutura número precisão dupla/simples) ========== */
 typedef uint64_t d_t;
@@ -19,39 +20,135 @@ typedef uint32_t s_t;
 /* Estrutura de número */
 typedef struct num_t {
     s_t *d;
-    uint32_t n;  /* número de limbos usados */
-    uint32_t t;  /* 0 = zero, 1 = positivo */
+    uint32_t n;     /* número de limbos usados */
+    uint32_t t;     /* 0 = zero, 1 = positivo */
+    uint32_t cap;   /* limbos disponíveis em d */
+    uint32_t fixo;  /* 1: d é da pilha ou da arena, nunca realocado nem liberado */
 } num_t;
 
+/* num_t com limbos na pilha para tamanhos conhecidos: NUM_FIXO(x, 64) declara num_t *x
+ * com 64 limbos. Se uma operação precisar de mais, os limbos passam para o heap
+ * (num_liberar devolve). */
+#define NUM_FIXO(nome, limbos) \
+    s_t nome##_limbos[limbos]; \
+    num_t nome##_num = { nome##_limbos, 0, 0, (limbos), 1 }, *nome = &nome##_num
+
 /* Base numérica b = 2^32 */
 const d_t b = ((d_t)(1) << (sizeof(s_t) << 3));
 
+/* ========== Alocação: heap contado e arena de limbos ========== */
+
+/* Chamadas a malloc/realloc feitas pelos num_t (--stats) */
+static unsigned long ALOCACOES;
+
+static void *alocar(size_t tam) {
+    ALOCACOES++;
+    return malloc(tam);
+}
+
+static void *realocar(void *p, size_t tam) {
+    ALOCACOES++;
+    return realloc(p, tam);
+}
+
+/* Temporários das operações saem de uma pilha de limbos: cada função guarda a marca,
+ * pega o que precisa e volta à marca no fim. Os blocos continuam alocados entre as
+ * chamadas, então uma arena já aquecida não vai mais ao heap. */
+#define ARENA_BLOCOS 32
+#define ARENA_INICIAL (1u << 17)  /* limbos (512 KiB): um dh de 1024 limbos com --ct */
+
+typedef struct arena_t {
+    s_t *bloco[ARENA_BLOCOS];
+    size_t tam[ARENA_BLOCOS];  /* limbos de cada bloco */
+    uint32_t atual;            /* bloco em uso */
+    size_t usado;              /* limbos usados no bloco atual */
+} arena_t;
+
+typedef struct marca_t {
+    uint32_t bloco;
+    size_t usado;
+} marca_t;
+
+/* n limbos (não zerados); NULL se faltar memória */
+static s_t *arena_limbos(arena_t *a, size_t n) {
+    for (uint32_t k = a->atual; k < ARENA_BLOCOS; k++) {
+        size_t ini = k == a->atual ? a->usado : 0;
+        if (!a->bloco[k]) {
+            size_t tam = k > 0 ? 2 * a->tam[k - 1] : ARENA_INICIAL;
+            if (tam < n) tam = n;
+            a->bloco[k] = (s_t *)alocar(tam * sizeof(s_t));
+            if (!a->bloco[k]) return NULL;
+            a->tam[k] = tam;
+        }
+        if (ini + n <= a->tam[k]) {
+            a->atual = k;
+            a->usado = ini + n;
+            return a->bloco[k] + ini;
+        }
+    }
+    return NULL;
+}
+
+static marca_t arena_marca(const arena_t *a) {
+    marca_t m = { a->atual, a->usado };
+    return m;
+}
+
+static void arena_voltar(arena_t *a, marca_t m) {
+    a->atual = m.bloco;
+    a->usado = m.usado;
+}
+
+static void arena_destruir(arena_t *a) {
+    for (uint32_t k = 0; k < ARENA_BLOCOS; k++) free(a->bloco[k]);
+    memset(a, 0, sizeof(*a));
+}
+
 /* ========== Funções auxiliares num_t ========== */
 
 static num_t *criar(void) {
-    num_t *z = (num_t *)malloc(sizeof(num_t));
+    num_t *z = (num_t *)alocar(sizeof(num_t));
     if (!z) return NULL;
     z->d = NULL;
     z->n = 0;
     z->t = 0;
+    z->cap = 0;
+    z->fixo = 0;
     return z;
 }
 
+/* Limbos que passaram para o heap (num_t fixo ou da arena que cresceu) */
+static void num_liberar(num_t *z) {
+    if (!z->fixo) free(z->d);
+    z->d = NULL;
+    z->n = z->cap = 0;
+}
+
 static void destruir(num_t **z) {
     if (!z || !*z) return;
-    free((*z)->d);
-    (*z)->d = NULL;
-    (*z)->n = 0;
+    num_liberar(*z);
     free(*z);
     *z = NULL;
 }
 
+/* z com cap limbos da arena, válido até ela voltar a uma marca anterior */
+static int num_arena(num_t *z, arena_t *ar, uint32_t cap) {
+    z->d = arena_limbos(ar, cap);
+    z->n = 0;
+    z->t = 0;
+    z->cap = z->d ? cap : 0;
+    z->fixo = 1;
+    return z->d != NULL;
+}
+
 static void zerar(num_t *z) {
     if (!z) return;
     z->t = 0;
     z->n = 0;
 }
 
+static int garantir_cap(num_t *z, uint32_t cap);
+
 /* Atribuir: dest = src */
 static void atribuir(num_t *dest, const num_t *src) {
     if (!dest || !src) return;
@@ -60,11 +157,7 @@ static void atribuir(num_t *dest, const num_t *src) {
         zerar(dest);
         return;
     }
-    if (dest->n < src->n) {
-        free(dest->d);
-        dest->d = (s_t *)malloc((size_t)src->n * sizeof(s_t));
-        if (!dest->d) return;
-    }
+    if (!garantir_cap(dest, src->n)) return;
     memcpy(dest->d, src->d, (size_t)src->n * sizeof(s_t));
     dest->n = src->n;
     dest->t = src->t;
@@ -81,15 +174,24 @@ static int igual(const num_t *z, int val) {
     return (z->d[0] == (s_t)(val & 0xFFFFFFFFu));
 }
 
-/* Garantir capacidade de pelo menos cap limbos */
+/* Garantir capacidade de pelo menos cap limbos. Um num_t fixo que não comporta cap
+ * passa a ter os limbos no heap, copiando os usados. */
 static int garantir_cap(num_t *z, uint32_t cap) {
     if (!z || cap == 0) return 0;
-    if (z->d && z->n >= cap) return 1;
-    s_t *novo = (s_t *)realloc(z->d, (size_t)cap * sizeof(s_t));
-    if (!novo) return 0;
+    if (z->d && z->cap >= cap) return 1;
+    s_t *novo;
+    if (z->fixo) {
+        novo = (s_t *)alocar((size_t)cap * sizeof(s_t));
+        if (!novo) return 0;
+        if (z->n > 0) memcpy(novo, z->d, (size_t)z->n * sizeof(s_t));
+        z->fixo = 0;
+    } else {
+        novo = (s_t *)realocar(z->d, (size_t)cap * sizeof(s_t));
+        if (!novo) return 0;
+    }
     z->d = novo;
-    if (z->n < cap)
-        memset(z->d + z->n, 0, (size_t)(cap - z->n) * sizeof(s_t));
+    z->cap = cap;
+    memset(z->d + z->n, 0, (size_t)(cap - z->n) * sizeof(s_t));
     return 1;
 }
 
@@ -101,6 +203,16 @@ static void setar_um(num_t *z) {
     z->t = 1;
 }
 
+/* z = n limbos de d, normalizado (d pode ser z->d) */
+static void num_de_limbos(num_t *z, const s_t *d, uint32_t n) {
+    while (n > 0 && d[n - 1] == 0) n--;
+    if (n == 0) { zerar(z); return; }
+    if (!garantir_cap(z, n)) return;
+    memcpy(z->d, d, (size_t)n * sizeof(s_t));
+    z->n = n;
+    z->t = 1;
+}
+
 /* Comparação: retorna <0 se a < b, 0 se a == b, >0 se a > b */
 static int comparar(const num_t *a, const num_t *b) {
     if (!a || !b) return 0;
@@ -169,29 +281,198 @@ static void subtrair(num_t *a, const num_t *b) {
     if (a->n == 0) a->t = 0;
 }
 
-/* Multiplicação: z = x * y (z pode ser igual a x ou y) */
-static void multiplicar(num_t *z, const num_t *x, const num_t *y) {
+/* ========== Multiplicação e quadrado sobre limbos ========== */
+
+/* A partir daqui (limbos de cada fator) a Karatsuba ganha do laço escolar: no --bench,
+ * compilando com -DKARATSUBA_LIMIAR=N, ela empata perto de 24 limbos e ganha de 32 em diante. */
+#ifndef KARATSUBA_LIMIAR
+#define KARATSUBA_LIMIAR 32
+#endif
+
+/* z[0..nx+ny) = x * y (laço escolar; z não pode ser x nem y) */
+static void mul_escolar(s_t *z, const s_t *x, uint32_t nx, const s_t *y, uint32_t ny) {
+    memset(z, 0, ((size_t)nx + ny) * sizeof(s_t));
+    for (uint32_t i = 0; i < nx; i++) {
+        d_t carry = 0;
+        for (uint32_t j = 0; j < ny; j++) {
+            d_t p = (d_t)x[i] * (d_t)y[j] + (d_t)z[i + j] + carry;
+            z[i + j] = (s_t)(p & (d_t)(-1));
+            carry = p >> (sizeof(s_t) * 8);
+        }
+        z[i + ny] = (s_t)carry;
+    }
+}
+
+/* z[0..2n) = x^2: os produtos x[i]*x[j] com i < j uma vez só, dobrados, mais a diagonal */
+static void quad_escolar(s_t *z, const s_t *x, uint32_t n) {
+    memset(z, 0, 2 * (size_t)n * sizeof(s_t));
+    for (uint32_t i = 0; i + 1 < n; i++) {
+        d_t carry = 0;
+        for (uint32_t j = i + 1; j < n; j++) {
+            d_t p = (d_t)x[i] * x[j] + z[i + j] + carry;
+            z[i + j] = (s_t)p;
+            carry = p >> 32;
+        }
+        z[i + n] = (s_t)carry;
+    }
+    s_t alto = 0;
+    for (uint32_t k = 0; k < 2 * n; k++) {
+        s_t v = z[k];
+        z[k] = (v << 1) | alto;
+        alto = v >> 31;
+    }
+    d_t carry = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        d_t p = (d_t)x[i] * x[i] + z[2 * i] + carry;
+        z[2 * i] = (s_t)p;
+        p = (d_t)z[2 * i + 1] + (p >> 32);
+        z[2 * i + 1] = (s_t)p;
+        carry = p >> 32;
+    }
+}
+
+/* a[0..na) += b[0..nb) (nb <= na), módulo b^na */
+static void acumular_limbos(s_t *a, uint32_t na, const s_t *bl, uint32_t nb) {
+    d_t carry = 0;
+    uint32_t i = 0;
+    for (; i < nb; i++) {
+        d_t s = (d_t)a[i] + bl[i] + carry;
+        a[i] = (s_t)s;
+        carry = s >> 32;
+    }
+    for (; carry && i < na; i++) {
+        d_t s = (d_t)a[i] + carry;
+        a[i] = (s_t)s;
+        carry = s >> 32;
+    }
+}
+
+/* a = -a módulo b^n */
+static void negar_limbos(s_t *a, uint32_t n) {
+    d_t carry = 1;
+    for (uint32_t i = 0; i < n; i++) {
+        d_t s = (d_t)(s_t)~a[i] + carry;
+        a[i] = (s_t)s;
+        carry = s >> 32;
+    }
+}
+
+/* d[0..l) = |x - y|, x com l limbos e y com h <= l; retorna 1 se x < y */
+static int diferenca_limbos(s_t *d, const s_t *x, const s_t *y, uint32_t l, uint32_t h) {
+    int menor_xy = 0;
+    for (uint32_t i = l; i > 0; i--) {
+        s_t yi = i - 1 < h ? y[i - 1] : 0;
+        if (x[i - 1] != yi) { menor_xy = x[i - 1] < yi; break; }
+    }
+    const s_t *a = menor_xy ? y : x, *c = menor_xy ? x : y;
+    uint32_t na = menor_xy ? h : l, nc = menor_xy ? l : h;
+    d_t emprestado = 0;
+    for (uint32_t i = 0; i < l; i++) {
+        d_t s = (d_t)(i < na ? a[i] : 0) - (i < nc ? c[i] : 0) - emprestado;
+        d[i] = (s_t)s;
+        emprestado = (s >> 32) & 1;
+    }
+    return menor_xy;
+}
+
+/* Limbos de rascunho que a Karatsuba de n limbos usa (|x0 - x1|, |y0 - y1|, o produto
+ * do meio com um limbo de folga e a recursão de ceil(n/2)). */
+static uint32_t tam_rascunho(uint32_t n) {
+    uint32_t total = 0;
+    while (n >= KARATSUBA_LIMIAR) {
+        uint32_t l = (n + 1) / 2;
+        total += 4 * l + 1;
+        n = l;
+    }
+    return total;
+}
+
+/* z[0..2n) = x * y, x e y com n limbos. Com x = x1*B + x0 e B = b^l:
+ * x*y = x1y1*B^2 + (x0y0 + x1y1 - (x0 - x1)(y0 - y1))*B + x0y0, três produtos de l limbos.
+ * w tem tam_rascunho(n) limbos; nada é alocado. */
+static void mul_karatsuba(s_t *z, const s_t *x, const s_t *y, uint32_t n, s_t *w) {
+    if (n < KARATSUBA_LIMIAR) {
+        mul_escolar(z, x, n, y, n);
+        return;
+    }
+    const uint32_t l = (n + 1) / 2, h = n - l;
+    s_t *dx = w, *dy = w + l, *meio = w + 2 * l, *resto = w + 4 * l + 1;
+    int negativo = diferenca_limbos(dx, x, x + l, l, h) ^ diferenca_limbos(dy, y, y + l, l, h);
+    mul_karatsuba(meio, dx, dy, l, resto);
+    meio[2 * l] = 0;
+    mul_karatsuba(z, x, y, l, resto);
+    mul_karatsuba(z + 2 * l, x + l, y + l, h, resto);
+    /* meio = x0y0 + x1y1 - (x0 - x1)(y0 - y1), em 2l + 1 limbos */
+    if (!negativo) negar_limbos(meio, 2 * l + 1);
+    acumular_limbos(meio, 2 * l + 1, z, 2 * l);
+    acumular_limbos(meio, 2 * l + 1, z + 2 * l, 2 * h);
+    acumular_limbos(z + l, l + 2 * h, meio, 2 * l + 1);
+}
+
+/* z[0..2n) = x^2, mesma recursão com dois quadrados e (x0 - x1)^2 no meio. */
+static void quad_karatsuba(s_t *z, const s_t *x, uint32_t n, s_t *w) {
+    if (n < KARATSUBA_LIMIAR) {
+        quad_escolar(z, x, n);
+        return;
+    }
+    const uint32_t l = (n + 1) / 2, h = n - l;
+    s_t *dx = w, *meio = w + 2 * l, *resto = w + 4 * l + 1;
+    diferenca_limbos(dx, x, x + l, l, h);
+    quad_karatsuba(meio, dx, l, resto);
+    meio[2 * l] = 0;
+    quad_karatsuba(z, x, l, resto);
+    quad_karatsuba(z + 2 * l, x + l, h, resto);
+    negar_limbos(meio, 2 * l + 1);
+    acumular_limbos(meio, 2 * l + 1, z, 2 * l);
+    acumular_limbos(meio, 2 * l + 1, z + 2 * l, 2 * h);
+    acumular_limbos(z + l, l + 2 * h, meio, 2 * l + 1);
+}
+
+/* Multiplicação: z = x * y (z pode ser igual a x ou y). Fatores de KARATSUBA_LIMIAR
+ * limbos ou mais vão para a Karatsuba (o menor completado com zeros). Produto e
+ * rascunho saem da arena. */
+static void multiplicar(num_t *z, const num_t *x, const num_t *y, arena_t *ar) {
     if (!z || !x || !y) return;
     if (x->n == 0 || y->n == 0) {
         zerar(z);
         return;
     }
-    uint32_t nz = x->n + y->n;
-    if (!garantir_cap(z, nz)) return;
-    memset(z->d, 0, (size_t)nz * sizeof(s_t));
-    for (uint32_t i = 0; i < x->n; i++) {
-        d_t carry = 0;
-        for (uint32_t j = 0; j < y->n; j++) {
-            d_t p = (d_t)x->d[i] * (d_t)y->d[j] + (d_t)z->d[i + j] + carry;
-            z->d[i + j] = (s_t)(p & (d_t)(-1));
-            carry = p >> (sizeof(s_t) * 8);
-        }
-        z->d[i + y->n] = (s_t)carry;
+    uint32_t nx = x->n, ny = y->n, n = nx > ny ? nx : ny;
+    int karatsuba = (nx < ny ? nx : ny) >= KARATSUBA_LIMIAR;
+    uint32_t nz = karatsuba ? 2 * n : nx + ny;
+    /* produto (e, na Karatsuba, fatores completados e rascunho) fora de z */
+    size_t limbos = nz + (karatsuba ? 2 * (size_t)n + tam_rascunho(n) : 0);
+    marca_t marca = arena_marca(ar);
+    s_t *prod = arena_limbos(ar, limbos);
+    if (!prod) return;
+    if (karatsuba) {
+        s_t *xp = prod + nz, *yp = xp + n;
+        memcpy(xp, x->d, (size_t)nx * sizeof(s_t));
+        memset(xp + nx, 0, (size_t)(n - nx) * sizeof(s_t));
+        memcpy(yp, y->d, (size_t)ny * sizeof(s_t));
+        memset(yp + ny, 0, (size_t)(n - ny) * sizeof(s_t));
+        mul_karatsuba(prod, xp, yp, n, yp + n);
+    } else {
+        mul_escolar(prod, x->d, nx, y->d, ny);
     }
-    z->n = nz;
-    z->t = 1;
-    while (z->n > 0 && z->d[z->n - 1] == 0) z->n--;
-    if (z->n == 0) z->t = 0;
+    num_de_limbos(z, prod, nz);
+    arena_voltar(ar, marca);
+}
+
+/* Quadrado: z = x^2 (z pode ser x); cerca de metade dos produtos de multiplicar(z, x, x). */
+static void quadrado(num_t *z, const num_t *x, arena_t *ar) {
+    if (!z || !x) return;
+    if (x->n == 0) {
+        zerar(z);
+        return;
+    }
+    uint32_t n = x->n;
+    marca_t marca = arena_marca(ar);
+    s_t *prod = arena_limbos(ar, 2 * (size_t)n + tam_rascunho(n));
+    if (!prod) return;
+    quad_karatsuba(prod, x->d, n, prod + 2 * n);
+    num_de_limbos(z, prod, 2 * n);
+    arena_voltar(ar, marca);
 }
 
 /* Deslocamento à esquerda: z = x * 2^bits (bits < 32) */
@@ -211,8 +492,9 @@ static void shl_bits(num_t *z, const num_t *x, unsigned bits) {
     z->t = x->t;
 }
 
-/* Divisão: q = u / v, r = u % v (v != 0). Shift-and-subtract. */
-static void dividir(num_t *q, num_t *r, const num_t *u, const num_t *v) {
+/* Divisão: q = u / v, r = u % v (v != 0). Shift-and-subtract, um bit do quociente
+ * por vez; fica como referência do teste diferencial (--testar-divisao). */
+static void dividir_binario(num_t *q, num_t *r, const num_t *u, const num_t *v) {
     if (!q || !r || !u || !v || v->n == 0) return;
     atribuir(r, u);
     if (menor(u, v)) {
@@ -251,40 +533,125 @@ static void dividir(num_t *q, num_t *r, const num_t *u, const num_t *v) {
     destruir(&somaq);
 }
 
+/* Divisão: q = u / v, r = u % v (v != 0). Algoritmo D de Knuth (TAOCP 4.3.1):
+ * normaliza v para o limbo alto ter o bit 31 ligado, estima cada dígito do
+ * quociente pelos dois limbos altos do resto (d_t / s_t) e corrige com no máximo
+ * uma soma de volta. q e r podem ser u ou v; os limbos de trabalho saem da arena. */
+static void dividir(num_t *q, num_t *r, const num_t *u, const num_t *v, arena_t *ar) {
+    if (!q || !r || !u || !v || v->n == 0) return;
+    if (menor(u, v)) {
+        atribuir(r, u);
+        zerar(q);
+        return;
+    }
+    const uint32_t n = v->n, m = u->n - v->n;
+    /* un: u normalizado (m + n + 1 limbos), vn: v normalizado, qd: quociente */
+    marca_t marca = arena_marca(ar);
+    s_t *un = arena_limbos(ar, (size_t)m + n + 1 + n + m + 1);
+    if (!un) return;
+    s_t *vn = un + m + n + 1, *qd = vn + n;
+
+    if (n == 1) {
+        /* divisor de um limbo: divisão curta */
+        d_t resto = 0, d = v->d[0];
+        for (uint32_t j = u->n; j > 0; j--) {
+            d_t num = (resto << 32) | u->d[j - 1];
+            qd[j - 1] = (s_t)(num / d);
+            resto = num % d;
+        }
+        un[0] = (s_t)resto;
+        num_de_limbos(q, qd, m + 1);
+        num_de_limbos(r, un, 1);
+        arena_voltar(ar, marca);
+        return;
+    }
+
+    const unsigned sh = (unsigned)__builtin_clz(v->d[n - 1]);
+    for (uint32_t i = n - 1; i > 0; i--)
+        vn[i] = sh ? (v->d[i] << sh) | (v->d[i - 1] >> (32 - sh)) : v->d[i];
+    vn[0] = v->d[0] << sh;
+    un[m + n] = sh ? u->d[m + n - 1] >> (32 - sh) : 0;
+    for (uint32_t i = m + n - 1; i > 0; i--)
+        un[i] = sh ? (u->d[i] << sh) | (u->d[i - 1] >> (32 - sh)) : u->d[i];
+    un[0] = u->d[0] << sh;
+
+    for (uint32_t j = m + 1; j > 0; j--) {
+        const uint32_t k = j - 1;
+        /* estimativa pelos dois limbos altos; erra para mais em no máximo 2 */
+        d_t num = ((d_t)un[k + n] << 32) | un[k + n - 1];
+        d_t qhat = num / vn[n - 1], rhat = num % vn[n - 1];
+        while (qhat >= b || qhat * vn[n - 2] > ((rhat << 32) | un[k + n - 2])) {
+            qhat--;
+            rhat += vn[n - 1];
+            if (rhat >= b) break;
+        }
+        /* un[k..k+n] -= qhat * vn */
+        int64_t t;
+        d_t emprestado = 0;
+        for (uint32_t i = 0; i < n; i++) {
+            d_t p = qhat * vn[i];
+            t = (int64_t)un[i + k] - (int64_t)emprestado - (int64_t)(p & 0xFFFFFFFFu);
+            un[i + k] = (s_t)t;
+            emprestado = (p >> 32) - (d_t)(t >> 32);
+        }
+        t = (int64_t)un[k + n] - (int64_t)emprestado;
+        un[k + n] = (s_t)t;
+        qd[k] = (s_t)qhat;
+        if (t < 0) {
+            /* qhat era um a mais: soma v de volta */
+            qd[k]--;
+            d_t c = 0;
+            for (uint32_t i = 0; i < n; i++) {
+                d_t s = (d_t)un[i + k] + vn[i] + c;
+                un[i + k] = (s_t)s;
+                c = s >> 32;
+            }
+            un[k + n] += (s_t)c;
+        }
+    }
+    /* resto = un >> sh */
+    for (uint32_t i = 0; i < n; i++)
+        un[i] = sh ? (un[i] >> sh) | (un[i + 1] << (32 - sh)) : un[i];
+    num_de_limbos(q, qd, m + 1);
+    num_de_limbos(r, un, n);
+    arena_voltar(ar, marca);
+}
+
 /* Módulo: r = u mod v */
-static void modulo(num_t *r, const num_t *u, const num_t *v) {
-    num_t *q = criar();
-    if (!q) return;
-    dividir(q, r, u, v);
-    destruir(&q);
+static void modulo(num_t *r, const num_t *u, const num_t *v, arena_t *ar) {
+    marca_t marca = arena_marca(ar);
+    num_t q;
+    if (num_arena(&q, ar, u->n >= v->n ? u->n - v->n + 1 : 1)) dividir(&q, r, u, v, ar);
+    arena_voltar(ar, marca);
 }
 
 /* ========== MDCE - Maior divisor comum estendido (slide) ========== */
-/* w = gcd(u,v), w = u*x + v*y */
-void mdce(num_t *w, num_t *x, num_t *y, num_t *u, num_t *v) {
-    num_t *a = criar(), *b = criar();
-    num_t *x1 = criar(), *x2 = criar(), *y1 = criar(), *y2 = criar();
-    num_t *q = criar(), *r = criar(), *qx1 = criar(), *qy1 = criar();
-    if (!a || !b || !x1 || !x2 || !y1 || !y2 || !q || !r || !qx1 || !qy1) {
-        destruir(&a); destruir(&b); destruir(&x1); destruir(&x2);
-        destruir(&y1); destruir(&y2); destruir(&q); destruir(&r);
-        destruir(&qx1); destruir(&qy1);
+/* w = gcd(u,v), w = u*x + v*y. Temporários na arena, todos fora do laço. */
+void mdce(num_t *w, num_t *x, num_t *y, num_t *u, num_t *v, arena_t *ar) {
+    marca_t marca = arena_marca(ar);
+    uint32_t cap = u->n + v->n + 2;
+    num_t t[12];
+    int ok = 1;
+    for (int i = 0; i < 12; i++) ok &= num_arena(&t[i], ar, cap);
+    if (!ok) {
+        arena_voltar(ar, marca);
         return;
     }
+    num_t *a = &t[0], *b = &t[1], *x1 = &t[2], *x2 = &t[3], *y1 = &t[4], *y2 = &t[5];
+    num_t *q = &t[6], *r = &t[7], *qx1 = &t[8], *qy1 = &t[9], *xx = &t[10], *yy = &t[11];
     atribuir(a, u);
     atribuir(b, v);
     zerar(x2); setar_um(x1);
     setar_um(y2); zerar(y1);
 
     while (v->n > 0) {
-        dividir(q, r, u, v);
+        dividir(q, r, u, v, ar);
         /* qx1 = q * x1, qy1 = q * y1 */
-        multiplicar(qx1, q, x1);
-        multiplicar(qy1, q, y1);
+        multiplicar(qx1, q, x1, ar);
+        multiplicar(qy1, q, y1, ar);
         /* x = x2 - qx1, y = y2 - qy1 */
-        num_t *xx = criar(), *yy = criar();
-        if (xx) { atribuir(xx, x2); subtrair(xx, qx1); atribuir(x, xx); destruir(&xx); }
-        if (yy) { atribuir(yy, y2); subtrair(yy, qy1); atribuir(y, yy); destruir(&yy); }
+        atribuir(xx, x2); subtrair(xx, qx1); atribuir(x, xx);
+        atribuir(yy, y2); subtrair(yy, qy1); atribuir(y, yy);
         /* u = v, v = r, x2 = x1, x1 = x, y2 = y1, y1 = y */
         atribuir(u, v);
         atribuir(v, r);
@@ -299,51 +666,165 @@ void mdce(num_t *w, num_t *x, num_t *y, num_t *u, num_t *v) {
     atribuir(x, x2);
     atribuir(y, y2);
 
-    destruir(&a); destruir(&b); destruir(&x1); destruir(&x2);
-    destruir(&y1); destruir(&y2); destruir(&q); destruir(&r);
-    destruir(&qx1); destruir(&qy1);
+    for (int i = 0; i < 12; i++) num_liberar(&t[i]);
+    arena_voltar(ar, marca);
 }
 
 /* ========== Inverso multiplicativo (slide) ========== */
-void inverso_m(num_t *v, num_t *u, num_t *m) {
-    num_t *w = criar();
-    num_t *x = criar();
-    num_t *y = criar();
-    if (!w || !x || !y) {
-        destruir(&w); destruir(&x); destruir(&y);
-        return;
+void inverso_m(num_t *v, num_t *u, num_t *m, arena_t *ar) {
+    marca_t marca = arena_marca(ar);
+    uint32_t cap = u->n + m->n + 2;
+    num_t w, x, y;
+    if (num_arena(&w, ar, cap) && num_arena(&x, ar, cap) && num_arena(&y, ar, cap)) {
+        mdce(&w, &x, &y, u, m, ar);
+        if (igual(&w, 1))
+            atribuir(v, &x);
+        else
+            zerar(v);
+        num_liberar(&w); num_liberar(&x); num_liberar(&y);
+    }
+    arena_voltar(ar, marca);
+}
+
+/* ========== Multiplicação de Montgomery (CIOS) ==========
+ * Para p ímpar com n limbos e R = b^n, os valores ficam na forma x*R mod p e
+ * mont_mul devolve x*y*R^-1 mod p, sem divisão: a redução soma múltiplos de p
+ * limbo a limbo (Coarsely Integrated Operand Scanning). */
+typedef struct mont_t {
+    const s_t *p;   /* limbos do módulo (ímpar, p->d) */
+    uint32_t n;     /* número de limbos de p */
+    s_t pinv;       /* -p^-1 mod b */
+    s_t *r2;        /* R^2 mod p, n limbos */
+    s_t *t;         /* acumulador do CIOS / quadrado de mont_quadrado, 2n + 1 limbos */
+    s_t *rascunho;  /* quad_karatsuba, tam_rascunho(n) limbos */
+} mont_t;
+
+/* -p0^-1 mod 2^32 por Newton: p0 * p0 = 1 mod 8 e cada passo dobra os bits certos. */
+static s_t mont_inverso(s_t p0) {
+    s_t x = p0;
+    for (int i = 0; i < 4; i++) x *= 2 - p0 * x;
+    return (s_t)0 - x;
+}
+
+/* Prepara o contexto para p ímpar > 1 com os limbos na arena (válidos até o chamador
+ * voltar à marca); retorna 0 se faltar memória. */
+static int mont_iniciar(mont_t *m, const num_t *p, arena_t *ar) {
+    const uint32_t n = p->n;
+    m->p = p->d;
+    m->n = n;
+    m->pinv = mont_inverso(p->d[0]);
+    m->r2 = arena_limbos(ar, n);
+    m->t = arena_limbos(ar, 2 * (size_t)n + 1);
+    m->rascunho = arena_limbos(ar, (size_t)tam_rascunho(n) + 1);
+    marca_t marca = arena_marca(ar);
+    num_t x, pot;
+    if (!m->r2 || !m->t || !m->rascunho || !num_arena(&x, ar, n) || !num_arena(&pot, ar, 2 * n + 1))
+        return 0;
+    /* R^2 mod p = 2^(64n) mod p: uma divisão de 2n + 1 limbos */
+    memset(pot.d, 0, (size_t)(2 * n) * sizeof(s_t));
+    pot.d[2 * n] = 1;
+    pot.n = 2 * n + 1;
+    pot.t = 1;
+    modulo(&x, &pot, p, ar);
+    memset(m->r2, 0, (size_t)n * sizeof(s_t));
+    if (x.n > 0) memcpy(m->r2, x.d, (size_t)x.n * sizeof(s_t));
+    arena_voltar(ar, marca);
+    return 1;
+}
+
+/* z = t - p, ou t se a subtração pedir emprestado além de t[n] (t < 2p, n + 1 limbos).
+ * A escolha é por máscara, sem desvio dependente dos dados (janela fixa). */
+static void mont_final(const mont_t *m, s_t *z, const s_t *t) {
+    const uint32_t n = m->n;
+    const s_t *p = m->p;
+    d_t emprestado = 0;
+    for (uint32_t j = 0; j < n; j++) {
+        d_t s = (d_t)t[j] - p[j] - emprestado;
+        z[j] = (s_t)s;
+        emprestado = (s >> 32) & 1;
+    }
+    s_t manter = (s_t)0 - (s_t)(emprestado & ~(d_t)t[n] & 1);
+    for (uint32_t j = 0; j < n; j++) z[j] = (t[j] & manter) | (z[j] & ~manter);
+}
+
+/* z = x * y * R^-1 mod p (x, y < p com n limbos; z pode ser x ou y). */
+static void mont_mul(const mont_t *m, s_t *z, const s_t *x, const s_t *y) {
+    const uint32_t n = m->n;
+    const s_t *p = m->p;
+    s_t *t = m->t;
+    memset(t, 0, ((size_t)n + 2) * sizeof(s_t));
+    for (uint32_t i = 0; i < n; i++) {
+        /* t += x * y[i] */
+        d_t c = 0;
+        for (uint32_t j = 0; j < n; j++) {
+            d_t s = (d_t)t[j] + (d_t)x[j] * y[i] + c;
+            t[j] = (s_t)s;
+            c = s >> 32;
+        }
+        d_t s = (d_t)t[n] + c;
+        t[n] = (s_t)s;
+        t[n + 1] = (s_t)(s >> 32);
+        /* t = (t + mm * p) / b, com mm escolhido para zerar o limbo baixo */
+        s_t mm = t[0] * m->pinv;
+        c = ((d_t)t[0] + (d_t)mm * p[0]) >> 32;
+        for (uint32_t j = 1; j < n; j++) {
+            s = (d_t)t[j] + (d_t)mm * p[j] + c;
+            t[j - 1] = (s_t)s;
+            c = s >> 32;
+        }
+        s = (d_t)t[n] + c;
+        t[n - 1] = (s_t)s;
+        t[n] = t[n + 1] + (s_t)(s >> 32);
     }
-    mdce(w, x, y, u, m);
-    if (igual(w, 1))
-        atribuir(v, x);
-    else
-        zerar(v);
-    destruir(&w); destruir(&x); destruir(&y);
+    mont_final(m, z, t);
+}
+
+/* z = x^2 * R^-1 mod p: quadrado completo (quad_karatsuba) e redução separada
+ * (Separated Operand Scanning), n^2 / 2 + n^2 produtos contra os 2n^2 do CIOS. */
+static void mont_quadrado(const mont_t *m, s_t *z, const s_t *x) {
+    const uint32_t n = m->n;
+    const s_t *p = m->p;
+    s_t *t = m->t;
+    quad_karatsuba(t, x, n, m->rascunho);
+    d_t topo = 0;  /* vai-um que sobra de t[i + n] para t[i + n + 1] */
+    for (uint32_t i = 0; i < n; i++) {
+        s_t mm = t[i] * m->pinv;
+        d_t c = 0;
+        for (uint32_t j = 0; j < n; j++) {
+            d_t s = (d_t)t[i + j] + (d_t)mm * p[j] + c;
+            t[i + j] = (s_t)s;
+            c = s >> 32;
+        }
+        d_t s = (d_t)t[i + n] + c + topo;
+        t[i + n] = (s_t)s;
+        topo = s >> 32;
+    }
+    t[2 * n] = (s_t)topo;
+    mont_final(m, z, t + n);
 }
 
 /* ========== Exponenciação modular: base^exp mod mod ========== */
-static void mod_pow(num_t *resultado, const num_t *base, const num_t *exp, const num_t *mod) {
-    num_t *r = criar(), *b = criar(), *e = criar();
-    if (!r || !b || !e) {
-        destruir(&r); destruir(&b); destruir(&e);
+/* Quadrado-e-multiplica da direita para a esquerda com multiplicar() + modulo();
+ * usada para módulos pares, onde não há Montgomery. */
+static void mod_pow_binario(num_t *resultado, const num_t *base, const num_t *exp, const num_t *mod, arena_t *ar) {
+    marca_t marca = arena_marca(ar);
+    uint32_t nb = base->n > mod->n ? base->n : mod->n;
+    num_t rv, bv, ev, tv, *r = &rv, *b = &bv, *e = &ev, *tmp = &tv;
+    if (!num_arena(r, ar, nb) || !num_arena(b, ar, nb) || !num_arena(e, ar, exp->n + 1) ||
+        !num_arena(tmp, ar, 2 * nb + 1)) {
+        arena_voltar(ar, marca);
         return;
     }
     setar_um(r);
     atribuir(b, base);
     atribuir(e, exp);
-    num_t *tmp = criar(), *q = criar(), *rem = criar();
-    if (!tmp || !q || !rem) {
-        destruir(&tmp); destruir(&q); destruir(&rem);
-        destruir(&r); destruir(&b); destruir(&e);
-        return;
-    }
     while (e->n > 0 && (e->t != 0)) {
         if (e->d[0] & 1) {
-            multiplicar(tmp, r, b);
-            modulo(r, tmp, mod);
+            multiplicar(tmp, r, b, ar);
+            modulo(r, tmp, mod, ar);
         }
-        multiplicar(tmp, b, b);
-        modulo(b, tmp, mod);
+        quadrado(tmp, b, ar);
+        modulo(b, tmp, mod, ar);
         /* e = e / 2 */
         d_t carry = 0;
         for (uint32_t i = e->n; i > 0; i--) {
@@ -356,8 +837,164 @@ static void mod_pow(num_t *resultado, const num_t *base, const num_t *exp, const
         if (e->n == 0) e->t = 0;
     }
     atribuir(resultado, r);
-    destruir(&r); destruir(&b); destruir(&e);
-    destruir(&tmp); destruir(&q); destruir(&rem);
+    arena_voltar(ar, marca);
+}
+
+/* Bits do expoente usados por janela (mesma escolha do OpenSSL): janelas maiores
+ * poupam multiplicações mas a tabela cresce com 2^(k-1) entradas. */
+static int janela_bits(uint32_t bits) {
+    if (bits > 671) return 6;
+    if (bits > 239) return 5;
+    if (bits > 79) return 4;
+    if (bits > 23) return 3;
+    return 1;
+}
+
+static uint32_t num_bits(const num_t *z) {
+    if (z->n == 0) return 0;
+    return z->n * 32 - (uint32_t)__builtin_clz(z->d[z->n - 1]);
+}
+
+static inline int bit_de(const num_t *z, uint32_t i) {
+    return (int)((z->d[i / 32] >> (i % 32)) & 1);
+}
+
+/* r = b^e (forma de Montgomery; r entra valendo 1*R). Quadrado-e-multiplica da direita
+ * para a esquerda, um bit por vez; b é destruído. */
+static void exp_binario(const mont_t *m, s_t *r, s_t *bb, const num_t *exp) {
+    for (uint32_t i = 0; i < exp->n; i++) {
+        for (int k = 0; k < 32; k++) {
+            if ((exp->d[i] >> k) & 1) mont_mul(m, r, r, bb);
+            if (i + 1 == exp->n && (exp->d[i] >> k) <= 1) break;  /* sem o último quadrado inútil */
+            mont_quadrado(m, bb, bb);
+        }
+    }
+}
+
+/* Janela deslizante da esquerda para a direita: tabela com b, b^3, ..., b^(2^k - 1) e,
+ * para cada janela que começa e termina num bit 1, k quadrados e uma multiplicação.
+ * tab tem 2^(k-1) * n limbos. */
+static void exp_janela(const mont_t *m, s_t *r, const s_t *bb, const num_t *exp, s_t *tab) {
+    const uint32_t n = m->n, bits = num_bits(exp);
+    if (bits == 0) return;
+    const int k = janela_bits(bits);
+    memcpy(tab, bb, (size_t)n * sizeof(s_t));
+    if (k > 1) {
+        mont_quadrado(m, r, bb);  /* r = b^2 provisório */
+        for (uint32_t j = 1; j < (1u << (k - 1)); j++)
+            mont_mul(m, tab + j * n, tab + (j - 1) * n, r);
+    }
+    int primeiro = 1;
+    int64_t i = (int64_t)bits - 1;
+    while (i >= 0) {
+        if (!bit_de(exp, (uint32_t)i)) {
+            mont_quadrado(m, r, r);
+            i--;
+            continue;
+        }
+        /* janela exp[i..l] com l >= i - k + 1 e bit l = 1 */
+        int64_t l = i - k + 1 > 0 ? i - k + 1 : 0;
+        while (!bit_de(exp, (uint32_t)l)) l++;
+        uint32_t val = 0;
+        for (int64_t j = i; j >= l; j--) val = (val << 1) | (uint32_t)bit_de(exp, (uint32_t)j);
+        if (primeiro) {
+            memcpy(r, tab + (val >> 1) * n, (size_t)n * sizeof(s_t));
+            primeiro = 0;
+        } else {
+            for (int64_t j = i; j >= l; j--) mont_quadrado(m, r, r);
+            mont_mul(m, r, r, tab + (val >> 1) * n);
+        }
+        i = l - 1;
+    }
+}
+
+/* Janela fixa em tempo constante: mesma sequência de quadrados e multiplicações para
+ * qualquer expoente com o mesmo número de limbos. A tabela b^0..b^(2^k - 1) fica
+ * espalhada limbo a limbo (entrada j do limbo i em tab[i * 2^k + j]) e cada consulta
+ * lê todas as entradas e escolhe por máscara, então nem o desvio nem o endereço
+ * acessado dependem do dígito. tab tem 2^k * n limbos; aux, n limbos. */
+static void exp_janela_fixa(const mont_t *m, s_t *r, const s_t *bb, const num_t *exp, s_t *tab, s_t *aux) {
+    const uint32_t n = m->n, bits = exp->n * 32;
+    if (bits == 0) return;
+    const int k = janela_bits(bits);
+    const uint32_t entradas = 1u << k;
+    /* espalhar: r (= 1*R) e b, depois b^j = b^(j-1) * b */
+    for (uint32_t i = 0; i < n; i++) {
+        tab[i * entradas] = r[i];
+        tab[i * entradas + 1] = bb[i];
+    }
+    memcpy(aux, bb, (size_t)n * sizeof(s_t));
+    for (uint32_t j = 2; j < entradas; j++) {
+        mont_mul(m, aux, aux, bb);
+        for (uint32_t i = 0; i < n; i++) tab[i * entradas + j] = aux[i];
+    }
+    /* Quadrados com mont_mul: a Karatsuba de mont_quadrado desvia pelo sinal de x0 - x1. */
+    uint32_t janelas = (bits + (uint32_t)k - 1) / (uint32_t)k;
+    for (uint32_t w = janelas; w > 0; w--) {
+        uint32_t pos = (w - 1) * (uint32_t)k, dig = 0;
+        for (int j = k - 1; j >= 0; j--)
+            dig = (dig << 1) | (pos + (uint32_t)j < bits ? (uint32_t)bit_de(exp, pos + (uint32_t)j) : 0);
+        /* juntar: aux = tab[dig] lendo as 2^k entradas de cada limbo */
+        for (uint32_t i = 0; i < n; i++) {
+            s_t v = 0;
+            for (uint32_t j = 0; j < entradas; j++) {
+                s_t mascara = (s_t)0 - (s_t)(((j ^ dig) - 1) >> 31);
+                v |= tab[i * entradas + j] & mascara;
+            }
+            aux[i] = v;
+        }
+        if (w == janelas) {
+            memcpy(r, aux, (size_t)n * sizeof(s_t));
+        } else {
+            for (int j = 0; j < k; j++) mont_mul(m, r, r, r);
+            mont_mul(m, r, r, aux);
+        }
+    }
+}
+
+enum { EXP_BINARIO, EXP_JANELA, EXP_JANELA_FIXA };
+
+/* --ct: exponenciação em janela fixa de tempo constante no comando dh */
+static int tempo_constante;
+
+/* base^exp mod p para p ímpar > 1 em forma de Montgomery: base e acumulador convertidos
+ * uma vez (x*R via mont_mul(x, R^2)) e de volta no fim (mont_mul(x, 1)). */
+static void mod_pow_mont(num_t *resultado, const num_t *base, const num_t *exp, const num_t *mod, int alg, arena_t *ar) {
+    marca_t marca = arena_marca(ar);
+    mont_t m;
+    const uint32_t n = mod->n;
+    uint32_t entradas = 1u << janela_bits(alg == EXP_JANELA ? num_bits(exp) : exp->n * 32);
+    s_t *r = arena_limbos(ar, (size_t)n * (4 + entradas));
+    num_t red;
+    if (!r || !num_arena(&red, ar, n) || !mont_iniciar(&m, mod, ar)) {
+        arena_voltar(ar, marca);
+        return;
+    }
+    s_t *bb = r + n, *um = bb + n, *aux = um + n, *tab = aux + n;
+    memset(r, 0, 3 * (size_t)n * sizeof(s_t));
+    /* base < p em n limbos */
+    if (menor(base, mod)) atribuir(&red, base);
+    else modulo(&red, base, mod, ar);
+    if (red.n > 0) memcpy(bb, red.d, (size_t)red.n * sizeof(s_t));
+    um[0] = 1;
+
+    mont_mul(&m, bb, bb, m.r2);   /* b*R */
+    mont_mul(&m, r, um, m.r2);    /* 1*R */
+    if (alg == EXP_BINARIO) exp_binario(&m, r, bb, exp);
+    else if (alg == EXP_JANELA) exp_janela(&m, r, bb, exp, tab);
+    else exp_janela_fixa(&m, r, bb, exp, tab, aux);
+    mont_mul(&m, r, r, um);
+    num_de_limbos(resultado, r, n);
+    arena_voltar(ar, marca);
+}
+
+/* Módulos ímpares vão para Montgomery (janela deslizante, ou janela fixa com --ct). */
+static void mod_pow(num_t *resultado, const num_t *base, const num_t *exp, const num_t *mod, arena_t *ar) {
+    if (!mod || mod->n == 0 || !(mod->d[0] & 1) || igual(mod, 1)) {
+        mod_pow_binario(resultado, base, exp, mod, ar);
+        return;
+    }
+    mod_pow_mont(resultado, base, exp, mod, tempo_constante ? EXP_JANELA_FIXA : EXP_JANELA, ar);
 }
 
 /* ========== Conversão hex <-> num_t ========== */
@@ -730,6 +1367,8 @@ static void bytes_to_hex(const uint8_t *buf, size_t len, char *out, size_t out_s
 }
 
 #define MAX_HEX_LEN  4096
+#define MAX_LINHA    8192
+#define LIMBOS_LINHA (MAX_LINHA / 8)  /* limbos de um número que ocupe a linha toda */
 #define MAX_BYTES    (MAX_HEX_LEN/2)
 #define KEY_BYTES    16
 #define IV_BYTES     16
@@ -738,12 +1377,196 @@ static void bytes_to_hex(const uint8_t *buf, size_t len, char *out, size_t out_s
 
 static aes_t aes_ctx;
 
+/* ========== Teste diferencial da divisão ========== */
+
+static uint64_t xorshift64(uint64_t *st) {
+    uint64_t x = *st;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    return *st = x;
+}
+
+/* Número aleatório de exatamente bits bits; com extremos, quase só limbos extremos
+ * (0, 1, 2^31 - 1, 2^31, b - 1), que exercitam as correções do qhat e a soma de volta
+ * do algoritmo D. */
+static void num_aleatorio(num_t *z, uint32_t bits, int extremos, uint64_t *st) {
+    uint32_t n = (bits + 31) / 32;
+    if (n == 0 || !garantir_cap(z, n)) { zerar(z); return; }
+    for (uint32_t i = 0; i < n; i++) {
+        uint64_t x = xorshift64(st);
+        z->d[i] = (s_t)x;
+        if (extremos && (x >> 32) % 4 != 0) {
+            static const s_t ext[5] = { 0, 1, 0x7FFFFFFFu, 0x80000000u, 0xFFFFFFFFu };
+            z->d[i] = ext[(x >> 40) % 5];
+        }
+    }
+    if (bits % 32) z->d[n - 1] &= (s_t)((1u << (bits % 32)) - 1);
+    z->d[n - 1] |= (s_t)1 << ((bits - 1) % 32);  /* exatamente bits bits */
+    z->n = n;
+    z->t = 1;
+}
+
+/* --testar-divisao [N]: N pares u, v aleatórios de até 4096 bits; dividir() tem de dar o
+ * mesmo q e r que dividir_binario() e q * v + r == u, r < v. O binário é quadrático nos
+ * bits do quociente, então a maioria dos casos tem quociente de até 512 bits. */
+static int testar_divisao(int casos) {
+    uint64_t st = 0x9E3779B97F4A7C15ull;
+    num_t *u = criar(), *v = criar(), *q = criar(), *r = criar(), *q0 = criar(), *r0 = criar();
+    num_t *qv = criar(), *soma = criar();
+    arena_t ar;
+    memset(&ar, 0, sizeof(ar));
+    int falhas = 0;
+    for (int c = 0; c < casos && !falhas; c++) {
+        uint32_t bu = 1 + (uint32_t)(xorshift64(&st) % 4096);
+        uint32_t lim = (xorshift64(&st) % 50 == 0) ? bu : (bu < 512 ? bu : 512);
+        uint32_t bq = (uint32_t)(xorshift64(&st) % (lim + 1));
+        uint32_t bv = bu - bq > 0 ? bu - bq : 1;
+        if (xorshift64(&st) % 10 == 0) bv = 1 + (uint32_t)(xorshift64(&st) % 4096);  /* v > u também */
+        num_aleatorio(u, bu, (int)(xorshift64(&st) & 1), &st);
+        num_aleatorio(v, bv, (int)(xorshift64(&st) & 1), &st);
+        dividir(q, r, u, v, &ar);
+        dividir_binario(q0, r0, u, v);
+        multiplicar(qv, q, v, &ar);
+        somar(soma, qv, r);
+        if (comparar(q, q0) != 0 || comparar(r, r0) != 0 || comparar(soma, u) != 0 || !menor(r, v)) {
+            char hu[MAX_HEX_LEN], hv[MAX_HEX_LEN];
+            num_to_hex(u, hu, sizeof(hu));
+            num_to_hex(v, hv, sizeof(hv));
+            fprintf(stderr, "divisao divergiu no caso %d:\nu=%s\nv=%s\n", c, hu, hv);
+            falhas++;
+        }
+    }
+    printf("divisao: %d casos, %d divergencias\n", casos, falhas);
+    destruir(&u); destruir(&v); destruir(&q); destruir(&r);
+    destruir(&q0); destruir(&r0); destruir(&qv); destruir(&soma);
+    arena_destruir(&ar);
+    return falhas != 0;
+}
+
+/* ========== --bench: exponenciação modular ========== */
+
+static double agora_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+/* Laço escolar x Karatsuba (produto e quadrado) de 8 a 256 limbos; todos têm de dar o
+ * mesmo produto do laço escolar. */
+static int bench_multiplicacao(void) {
+    static const uint32_t tams[] = { 8, 16, 24, 32, 48, 64, 128, 256 };
+    uint64_t st = 0x9E3779B97F4A7C15ull;
+    int falhas = 0;
+    for (size_t it = 0; it < sizeof(tams) / sizeof(tams[0]); it++) {
+        const uint32_t n = tams[it];
+        s_t *x = (s_t *)malloc(((size_t)6 * n + tam_rascunho(n)) * sizeof(s_t));
+        s_t *y = x + n, *ref = y + n, *z = ref + 2 * n, *w = z + 2 * n;
+        for (uint32_t i = 0; i < 2 * n; i++) x[i] = (s_t)xorshift64(&st);
+        mul_escolar(ref, x, n, y, n);
+        char caso[32];
+        snprintf(caso, sizeof(caso), "%u limbos", n);
+        double base = 0;
+        for (int a = 0; a < 4; a++) {
+            static const char *nomes[4] = { "mul escolar", "mul karatsuba", "quad escolar", "quad karatsuba" };
+            double seg = 1e30;
+            for (int rodada = 0; rodada < 5; rodada++) {  /* a melhor de 5 rodadas */
+                int reps = 0;
+                double t0 = agora_s(), dt;
+                do {
+                    for (int r = 0; r < 64; r++) {
+                        if (a == 0) mul_escolar(z, x, n, y, n);
+                        else if (a == 1) mul_karatsuba(z, x, y, n, w);
+                        else if (a == 2) quad_escolar(z, x, n);
+                        else quad_karatsuba(z, x, n, w);
+                    }
+                    reps += 64;
+                    dt = agora_s() - t0;
+                } while (dt < 0.02);
+                if (dt / reps < seg) seg = dt / reps;
+            }
+            if (a == 0) base = seg;
+            if (a == 2) mul_escolar(ref, x, n, x, n);
+            if (memcmp(z, ref, 2 * (size_t)n * sizeof(s_t)) != 0) {
+                fprintf(stderr, "%s divergiu do laco escolar com %u limbos\n", nomes[a], n);
+                falhas++;
+            }
+            printf("%-12s %-20s %10.1f K op/s %5.2fx\n", caso, nomes[a], 1e-3 / seg, base / seg);
+        }
+        free(x);
+    }
+    return falhas;
+}
+
+/* Exponenciações por segundo de cada algoritmo em módulos ímpares de 512 a 4096 bits,
+ * com expoente de 256 bits (o a*b do dh) e do tamanho do módulo. A base da razão é o
+ * laço bit a bit em Montgomery; todos têm de dar o mesmo resultado. */
+static int executar_bench(void) {
+    static const uint32_t bits_mod[] = { 512, 1024, 2048, 4096 };
+    struct { const char *nome; int alg; } algs[4] = {
+        { "binario", EXP_BINARIO }, { "janela deslizante", EXP_JANELA },
+        { "janela fixa (ct)", EXP_JANELA_FIXA }, { "multiplicar+modulo", -1 } };
+    uint64_t st = 0x2545F4914F6CDD1Dull;
+    num_t *p = criar(), *g = criar(), *e = criar(), *ref = criar(), *res = criar();
+    arena_t ar;
+    memset(&ar, 0, sizeof(ar));
+    int falhas = 0;
+    for (size_t im = 0; im < sizeof(bits_mod) / sizeof(bits_mod[0]); im++) {
+        for (int tam_exp = 0; tam_exp < 2; tam_exp++) {
+            uint32_t be = tam_exp ? bits_mod[im] : 256;
+            num_aleatorio(p, bits_mod[im], 0, &st);
+            p->d[0] |= 1;
+            num_aleatorio(g, bits_mod[im] - 1, 0, &st);
+            num_aleatorio(e, be, 0, &st);
+            char caso[32];
+            snprintf(caso, sizeof(caso), "p%u e%u", bits_mod[im], be);
+            double base = 0;
+            for (int a = 0; a < 4; a++) {
+                double seg = 1e30;
+                for (int rodada = 0; rodada < 5; rodada++) {  /* a melhor de 5 rodadas */
+                    int reps = 0;
+                    double t0 = agora_s(), dt;
+                    do {
+                        if (algs[a].alg < 0) mod_pow_binario(res, g, e, p, &ar);
+                        else mod_pow_mont(res, g, e, p, algs[a].alg, &ar);
+                        reps++;
+                        dt = agora_s() - t0;
+                    } while (dt < 0.04);
+                    if (dt / reps < seg) seg = dt / reps;
+                }
+                if (a == 0) { base = seg; atribuir(ref, res); }
+                else if (comparar(res, ref) != 0) {
+                    fprintf(stderr, "%s divergiu do binario em %s\n", algs[a].nome, caso);
+                    falhas++;
+                }
+                printf("%-12s %-20s %10.1f exp/s  %5.2fx\n", caso, algs[a].nome, 1.0 / seg, base / seg);
+            }
+        }
+    }
+    destruir(&p); destruir(&g); destruir(&e); destruir(&ref); destruir(&res);
+    arena_destruir(&ar);
+    falhas += bench_multiplicacao();
+    return falhas != 0;
+}
+
 #define DEFAULT_INPUT   "criptografia.input"
 #define DEFAULT_OUTPUT "criptografia.output"
 
 int main(int argc, char **argv) {
-    const char *input_file = (argc > 1) ? argv[1] : DEFAULT_INPUT;
-    const char *output_file = (argc > 2) ? argv[2] : DEFAULT_OUTPUT;
+    if (argc > 1 && strcmp(argv[1], "--testar-divisao") == 0)
+        return testar_divisao(argc > 2 ? atoi(argv[2]) : 1000);
+    if (argc > 1 && strcmp(argv[1], "--bench") == 0) return executar_bench();
+
+    /* [--ct] [--stats] [entrada [saida]] */
+    const char *input_file = DEFAULT_INPUT;
+    const char *output_file = DEFAULT_OUTPUT;
+    int posicionais = 0, estatisticas = 0;
+    for (int a = 1; a < argc; a++) {
+        if (strcmp(argv[a], "--ct") == 0) tempo_constante = 1;
+        else if (strcmp(argv[a], "--stats") == 0) estatisticas = 1;
+        else if (posicionais == 0) { input_file = argv[a]; posicionais++; }
+        else if (posicionais == 1) { output_file = argv[a]; posicionais++; }
+    }
 
     FILE *fin = fopen(input_file, "r");
     if (!fin) {
@@ -777,8 +1600,17 @@ int main(int argc, char **argv) {
     aes_ctx.c0 = iv;
     aes_ctx.Nk = AES128_NK;
 
+    /* Arena dos temporários do dh, aquecida aqui: daí em diante o dh não vai ao heap. */
+    arena_t arena;
+    memset(&arena, 0, sizeof(arena));
+    marca_t inicio = arena_marca(&arena);
+    arena_limbos(&arena, ARENA_INICIAL);
+    arena_voltar(&arena, inicio);
+    unsigned long alocacoes_preparacao = ALOCACOES, alocacoes_dh = 0;
+    int comandos_dh = 0;
+
     for (int op = 0; op < n; op++) {
-        char line[8192];
+        char line[MAX_LINHA];
         if (!fgets(line, sizeof(line), fin)) break;
         char *cmd = line;
         while (*cmd == ' ' || *cmd == '\t') cmd++;
@@ -804,25 +1636,21 @@ int main(int argc, char **argv) {
                 if (*cmd) *cmd = '\0';
                 while (*p_str == ' ') p_str++;
 
-                num_t *a = criar(), *b = criar(), *g = criar(), *p = criar();
-                num_t *s = criar();
-                if (!a || !b || !g || !p || !s) {
-                    destruir(&a); destruir(&b); destruir(&g); destruir(&p); destruir(&s);
-                    continue;
-                }
+                unsigned long antes = ALOCACOES;
+                NUM_FIXO(a, LIMBOS_LINHA);
+                NUM_FIXO(b, LIMBOS_LINHA);
+                NUM_FIXO(g, LIMBOS_LINHA);
+                NUM_FIXO(p, LIMBOS_LINHA);
+                NUM_FIXO(s, LIMBOS_LINHA);
+                NUM_FIXO(ab, 2 * LIMBOS_LINHA);
                 num_from_hex(a, a_str);
                 num_from_hex(b, b_str);
                 num_from_hex(g, g_str);
                 num_from_hex(p, p_str);
 
                 /* s = g^(a*b) mod p (shared secret) */
-                num_t *ab = criar(), *exp = criar();
-                if (ab && exp) {
-                    multiplicar(ab, a, b);
-                    mod_pow(s, g, ab, p);
-                    destruir(&ab);
-                    destruir(&exp);
-                }
+                multiplicar(ab, a, b, &arena);
+                mod_pow(s, g, ab, p, &arena);
 
                 /* Saída s= em hex (128 bits = 32 hex chars, conforme formato do exercício) */
                 char hex_buf[MAX_HEX_LEN];
@@ -847,7 +1675,10 @@ int main(int argc, char **argv) {
 
                 KeyExpansion(ke, key, (uint8_t)AES128_NK);
 
-                destruir(&a); destruir(&b); destruir(&g); destruir(&p); destruir(&s);
+                num_liberar(a); num_liberar(b); num_liberar(g);
+                num_liberar(p); num_liberar(s); num_liberar(ab);
+                alocacoes_dh += ALOCACOES - antes;
+                comandos_dh++;
             } else {
                 /* d c - decriptar */
                 cmd += 1;
@@ -907,5 +1738,9 @@ int main(int argc, char **argv) {
     }
     fclose(fin);
     fclose(fout);
+    arena_destruir(&arena);
+    if (estatisticas)
+        printf("Alocacoes no heap: %lu na preparacao, %lu nos %d comandos dh\n",
+               alocacoes_preparacao, alocacoes_dh, comandos_dh);
     return 0;
 }